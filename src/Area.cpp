@@ -6,20 +6,28 @@
 #include "Area.h"
 #include "AreaOrderer.h"
 
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <vector>
 
 //static const double PI = 3.1415926535897932;
 
-CArea::CArea(double accuracy) : m_accuracy(accuracy) {
+#ifdef AREA_COUNTERS
+CAreaCounters CArea::counters;
+#endif
+
+CArea::CArea(double accuracy) : m_ordered(false), m_ordered_num_curves(0), m_accuracy(accuracy) {
 
 }
 
-CArea::CArea(const CArea &rhs) : m_curves(rhs.m_curves), m_accuracy(rhs.m_accuracy) {
+CArea::CArea(const CArea &rhs) : m_ordered(rhs.m_ordered), m_ordered_num_curves(rhs.m_ordered_num_curves), m_curves(rhs.m_curves), m_accuracy(rhs.m_accuracy) {
 }
 
 void CArea::append(const CCurve& curve)
 {
 	m_curves.push_back(curve);
+	SetOrdered(false);
 }
 
 void CArea::FitArcs(){
@@ -29,6 +37,14 @@ void CArea::FitArcs(){
 	}
 }
 
+void CArea::Simplify(double tolerance)
+{
+	for(auto &curve : m_curves)
+	{
+		curve.Simplify(tolerance);
+	}
+}
+
 Point CArea::NearestPoint(const Point& p)const
 {
 	double best_dist = 0.0;
@@ -66,6 +82,16 @@ void CArea::Reorder(CAreaProcessingContext *ctx)
 	// returns 0, if the curves are OK
 	// returns 1, if the curves are overlapping
 
+	if(ctx && ctx->trust_ordered && IsOrdered())
+	{
+		// already nested and oriented, by Offset, Thicken, Split or an earlier Reorder
+		AREA_COUNT(counters.reorders_skipped);
+		if(ctx->set_processing_length_in_split)ctx->processing_done += ctx->split_processing_length;
+		return;
+	}
+
+	AREA_COUNT(counters.reorders_done);
+
 	CAreaOrderer ao;
 	for(auto &curve : m_curves)
 	{
@@ -77,6 +103,7 @@ void CArea::Reorder(CAreaProcessingContext *ctx)
 	}
 
 	*this = ao.ResultArea(m_accuracy);
+	SetOrdered(true);
 }
 
 class ZigZag
@@ -445,7 +472,7 @@ static void zigzag(const CArea &input_a, ZigZagState &zz, CAreaProcessingContext
 		c.m_vertices.push_back(CVertex(CVertex::vt_line, p0, null_point, 1));
 		CArea a2(input_a.m_accuracy);
 		a2.m_curves.push_back(c);
-		a2.Intersect(a);
+		a2.Intersect(a, ctx);
 		make_zig(a2, y0, y, zz);
 		zz.rightward = !zz.rightward;
 		if(ctx && ctx->please_abort)return;
@@ -497,7 +524,7 @@ void CArea::MakePocketToolpath(std::list<CCurve> &curve_list, const CAreaPocketP
 	CArea a_offset = *this;
 	double current_offset = params.tool_radius + params.extra_offset;
 
-	a_offset.Offset(current_offset);
+	a_offset.Offset(current_offset, ctx);
 
 	if(params.mode == PocketMode::ZigZag || params.mode == PocketMode::ZigZagThenSingleOffset)
 	{
@@ -506,8 +533,9 @@ void CArea::MakePocketToolpath(std::list<CCurve> &curve_list, const CAreaPocketP
 	}
 	else if(params.mode == PocketMode::Spiral)
 	{
+		// a_offset is just as Offset left it, so it needn't be reordered
 		std::list<CArea> areas;
-		a_offset.Split(areas, ctx);
+		a_offset.SplitInto(areas, ctx, true);
 		if(ctx && ctx->please_abort)return;
 		if(areas.size() == 0)
 		{
@@ -534,6 +562,11 @@ void CArea::MakePocketToolpath(std::list<CCurve> &curve_list, const CAreaPocketP
 }
 
 void CArea::Split(std::list<CArea> &areas, CAreaProcessingContext *ctx)const
+{
+	SplitInto(areas, ctx, ctx && ctx->trust_ordered);
+}
+
+void CArea::SplitInto(std::list<CArea> &areas, CAreaProcessingContext *ctx, bool trust_ordered)const
 {
 	if(IsBoolean())
 	{
@@ -545,24 +578,40 @@ void CArea::Split(std::list<CArea> &areas, CAreaProcessingContext *ctx)const
 	}
 	else
 	{
-		CArea a = *this;
-		a.Reorder(ctx);
+		// only copy and reorder if the curves aren't already in order
+		std::unique_ptr<CArea> reordered;
+		if(trust_ordered && IsOrdered())
+		{
+			AREA_COUNT(counters.reorders_skipped);
+			AREA_COUNT(counters.split_copies_skipped);
+		}
+		else
+		{
+			reordered = std::make_unique<CArea>(*this);
+			reordered->Reorder(ctx);
+		}
+		const CArea &a = reordered ? *reordered : *this;
 
 		if(ctx && ctx->please_abort)return;
 
+		std::list<CArea> new_areas;
 		for(const auto &curve : a.m_curves)
 		{
 			if(curve.IsClockwise())
 			{
-				if(areas.size() > 0)
-					areas.back().m_curves.push_back(curve);
+				if(new_areas.size() > 0)
+					new_areas.back().m_curves.push_back(curve);
 			}
 			else
 			{
-				areas.push_back(CArea(m_accuracy));
-				areas.back().m_curves.push_back(curve);
+				new_areas.push_back(CArea(m_accuracy));
+				new_areas.back().m_curves.push_back(curve);
 			}
 		}
+
+		// each one is an outside followed by its insides, so needs no more reordering
+		for(auto &new_area : new_areas)new_area.SetOrdered(true);
+		areas.splice(areas.end(), new_areas);
 	}
 }
 
@@ -591,23 +640,26 @@ OverlapType GetOverlapType(const CCurve& c1, const CCurve& c2)
 
 OverlapType GetOverlapType(const CArea& a1, const CArea& a2)
 {
-	CArea A1(a1);
+	// only whether anything is left matters, so the results aren't fitted with arcs
+	CAreaProcessingContext lines_ctx;
+	lines_ctx.fit_arcs = false;
 
-	A1.Subtract(a2);
+	CArea A1(a1);
+	A1.Subtract(a2, &lines_ctx);
 	if(A1.m_curves.size() == 0)
 	{
 		return OverlapType::Inside;
 	}
 
 	CArea A2(a2);
-	A2.Subtract(a1);
+	A2.Subtract(a1, &lines_ctx);
 	if(A2.m_curves.size() == 0)
 	{
 		return OverlapType::Outside;
 	}
 
 	A1 = a1;
-	A1.Intersect(a2);
+	A1.Intersect(a2, &lines_ctx);
 	if(A1.m_curves.size() == 0)
 	{
 		return OverlapType::Siblings;
@@ -615,28 +667,138 @@ OverlapType GetOverlapType(const CArea& a1, const CArea& a2)
 
 	return OverlapType::Crossing;
 }
-#if 0
 bool IsInside(const Point& p, const CCurve& c)
 {
-	CArea a;
-	a.m_curves.push_back(c);
-	return IsInside(p, a);
+	return c.WindingNumber(p) != 0;
 }
-#endif
 
 bool IsInside(const Point& p, const CArea& a)
 {
-    CArea a2(a.m_accuracy);
-	CCurve c;
-	c.m_vertices.push_back(CVertex(Point(p.x - 0.01, p.y - 0.01)));
-	c.m_vertices.push_back(CVertex(Point(p.x + 0.01, p.y - 0.01)));
-	c.m_vertices.push_back(CVertex(Point(p.x + 0.01, p.y + 0.01)));
-	c.m_vertices.push_back(CVertex(Point(p.x - 0.01, p.y + 0.01)));
-	c.m_vertices.push_back(CVertex(Point(p.x - 0.01, p.y - 0.01)));
-	a2.m_curves.push_back(c);
-	a2.Intersect(a);
-	if(fabs(a2.GetArea()) < 0.0004)return false;
-	return true;
+	// the curves of an area don't cross each other, so a point is inside if it is inside an odd number of them
+	// which, whatever their directions, is when the total winding number is odd
+	int w = 0;
+	for(const auto &curve : a.m_curves)
+	{
+		w += curve.WindingNumber(p);
+	}
+	return (w & 1) != 0;
+}
+
+class WindingSpans
+{
+	// the spans of an area flattened into arrays, laid out so that one span can be tested against many points
+	// in a loop without branches, which the compiler can vectorize.
+	// every span is added as a line; arcs add their chord and are also added to the arc arrays
+
+public:
+	std::vector<double> m_x0, m_y0, m_x1, m_y1, m_line_ylo, m_line_yhi;
+	std::vector<double> m_cx, m_cy, m_r2, m_sx, m_sy, m_ex, m_ey, m_dir, m_arc_ylo, m_arc_yhi;
+
+	WindingSpans(const CArea& a)
+	{
+		for(const auto &curve : a.m_curves)
+		{
+			if(curve.m_vertices.size() == 0)continue;
+			const Point *prev_p = nullptr;
+			for(const auto &vertex : curve.m_vertices)
+			{
+				if(prev_p)AddSpan(*prev_p, vertex);
+				prev_p = &(vertex.m_p);
+			}
+			AddSpan(curve.m_vertices.back().m_p, CVertex(curve.m_vertices.front().m_p));
+		}
+	}
+
+	void AddSpan(const Point& s, const CVertex& v)
+	{
+		m_x0.push_back(s.x);
+		m_y0.push_back(s.y);
+		m_x1.push_back(v.m_p.x);
+		m_y1.push_back(v.m_p.y);
+		m_line_ylo.push_back(std::min(s.y, v.m_p.y));
+		m_line_yhi.push_back(std::max(s.y, v.m_p.y));
+		if(v.m_type)
+		{
+			Point vs = s - v.m_c;
+			double r2 = vs * vs;
+			double r = sqrt(r2);
+			m_cx.push_back(v.m_c.x);
+			m_cy.push_back(v.m_c.y);
+			m_r2.push_back(r2);
+			m_sx.push_back(s.x);
+			m_sy.push_back(s.y);
+			m_ex.push_back(v.m_p.x);
+			m_ey.push_back(v.m_p.y);
+			m_dir.push_back(v.m_type);
+			m_arc_ylo.push_back(v.m_c.y - r);
+			m_arc_yhi.push_back(v.m_c.y + r);
+		}
+	}
+
+	void AddWindings(size_t num_pts, const double* px, const double* py, double* w, double ymin, double ymax)const
+	{
+		// these must give the same answers as Span::WindingNumber
+		// spans which are completely above or below all the points can't change their windings
+		for(size_t j = 0; j < m_x0.size(); j++)
+		{
+			if(m_line_yhi[j] < ymin || m_line_ylo[j] > ymax)continue;
+			const double x0 = m_x0[j], y0 = m_y0[j], dx = m_x1[j] - x0, y1 = m_y1[j], dy = y1 - y0;
+			for(size_t i = 0; i < num_pts; i++)
+			{
+				double side = dx * (py[i] - y0) - (px[i] - x0) * dy;
+				double up = ((y0 <= py[i]) & (y1 > py[i]) & (side > 0)) ? 1.0 : 0.0;
+				double down = ((y0 > py[i]) & (y1 <= py[i]) & (side < 0)) ? 1.0 : 0.0;
+				w[i] += up - down;
+			}
+		}
+
+		for(size_t j = 0; j < m_cx.size(); j++)
+		{
+			if(m_arc_yhi[j] < ymin || m_arc_ylo[j] > ymax)continue;
+			const double cx = m_cx[j], cy = m_cy[j], r2 = m_r2[j], sx = m_sx[j], sy = m_sy[j];
+			const double dx = m_ex[j] - sx, dy = m_ey[j] - sy;
+			const double dir = m_dir[j];
+			for(size_t i = 0; i < num_pts; i++)
+			{
+				double vx = px[i] - cx;
+				double vy = py[i] - cy;
+				double side = dx * (py[i] - sy) - (px[i] - sx) * dy;
+				w[i] += ((vx * vx + vy * vy < r2) & (side * dir < 0)) ? dir : 0.0;
+			}
+		}
+	}
+};
+
+void IsInside(const Point* pts, size_t num_pts, const CArea& a, bool* inside)
+{
+	WindingSpans spans(a);
+
+	// sort the points by y and do them in blocks; each block is a thin strip, so most spans miss it entirely,
+	// and the block's coordinates and windings stay in cache while the remaining spans pass over them
+	std::vector<size_t> order(num_pts);
+	for(size_t i = 0; i < num_pts; i++)order[i] = i;
+	std::sort(order.begin(), order.end(), [pts](size_t i, size_t j){return pts[i].y < pts[j].y;});
+
+	static const size_t block_size = 256;
+	double px[block_size];
+	double py[block_size];
+	double w[block_size];
+
+	for(size_t start = 0; start < num_pts; start += block_size)
+	{
+		size_t n = std::min(block_size, num_pts - start);
+		for(size_t i = 0; i < n; i++)
+		{
+			const Point &p = pts[order[start + i]];
+			px[i] = p.x;
+			py[i] = p.y;
+			w[i] = 0.0;
+		}
+
+		spans.AddWindings(n, px, py, w, py[0], py[n - 1]);
+
+		for(size_t i = 0; i < n; i++)inside[order[start + i]] = (static_cast<int>(w[i]) & 1) != 0;
+	}
 }
 
 void CArea::SpanIntersections(const Span& span, std::list<Point> &pts)const
@@ -668,26 +830,166 @@ void CArea::SpanIntersections(const Span& span, std::list<Point> &pts)const
 	}
 }
 
+class SpanBoxTree
+{
+	// a bounding box hierarchy over the spans of an area,
+	// so that a span is only intersected with the spans whose boxes touch its box
+
+	struct Node
+	{
+		CBox2D m_box;
+		unsigned int m_first; // index into m_order of the first span, for a leaf
+		unsigned int m_count; // number of spans, 0 if this isn't a leaf
+		int m_children[2];
+	};
+
+	static const unsigned int max_leaf_spans = 4;
+
+	std::vector<Span> m_spans;
+	std::vector<CBox2D> m_boxes;
+	std::vector<unsigned int> m_order; // used while building, after which the spans are stored in this order
+	std::vector<Node> m_nodes;
+
+	int Build(unsigned int first, unsigned int count)
+	{
+		int node_index = static_cast<int>(m_nodes.size());
+		m_nodes.push_back(Node());
+		CBox2D box;
+		for(unsigned int i = first; i < first + count; i++)box.Insert(m_boxes[m_order[i]]);
+		m_nodes[node_index].m_box = box;
+
+		if(count <= max_leaf_spans)
+		{
+			m_nodes[node_index].m_first = first;
+			m_nodes[node_index].m_count = count;
+			return node_index;
+		}
+
+		// split at the median of the box centres, along the longest side
+		bool split_x = box.Width() > box.Height();
+		unsigned int half = count / 2;
+		std::nth_element(m_order.begin() + first, m_order.begin() + first + half, m_order.begin() + first + count,
+			[this, split_x](unsigned int i, unsigned int j){
+				Point ci = m_boxes[i].Centre();
+				Point cj = m_boxes[j].Centre();
+				return split_x ? (ci.x < cj.x) : (ci.y < cj.y);
+		});
+
+		int left = Build(first, half);
+		int right = Build(first + half, count - half);
+		m_nodes[node_index].m_count = 0;
+		m_nodes[node_index].m_children[0] = left;
+		m_nodes[node_index].m_children[1] = right;
+		return node_index;
+	}
+
+	static bool BoxesTouch(const CBox2D& b1, const CBox2D& b2, double tolerance)
+	{
+		return b1.MinX() <= b2.MaxX() + tolerance && b2.MinX() <= b1.MaxX() + tolerance &&
+			b1.MinY() <= b2.MaxY() + tolerance && b2.MinY() <= b1.MaxY() + tolerance;
+	}
+
+public:
+	SpanBoxTree(const CArea& a)
+	{
+		for(const auto &curve : a.m_curves)
+		{
+			const Point *prev_p = nullptr;
+			for(const auto &vertex : curve.m_vertices)
+			{
+				if(prev_p)
+				{
+					m_spans.push_back(Span(*prev_p, vertex));
+					CBox2D box;
+					m_spans.back().GetBox(box);
+					m_boxes.push_back(box);
+				}
+				prev_p = &(vertex.m_p);
+			}
+		}
+
+		if(m_spans.size() == 0)return;
+		m_order.resize(m_spans.size());
+		for(unsigned int i = 0; i < m_order.size(); i++)m_order[i] = i;
+		m_nodes.reserve(2 * m_spans.size() / max_leaf_spans + 1);
+		Build(0, static_cast<unsigned int>(m_spans.size()));
+
+		// put each leaf's spans next to each other, so they can be intersected as an array
+		std::vector<Span> spans;
+		std::vector<CBox2D> boxes;
+		spans.reserve(m_spans.size());
+		boxes.reserve(m_boxes.size());
+		for(unsigned int s : m_order)
+		{
+			spans.push_back(m_spans[s]);
+			boxes.push_back(m_boxes[s]);
+		}
+		m_spans.swap(spans);
+		m_boxes.swap(boxes);
+	}
+
+	void Intersect(const Span& span, std::list<Point> &pts)const
+	{
+		// adds the intersections of span with all the spans in the tree, in no particular order
+		if(m_nodes.size() == 0)return;
+
+		CBox2D box;
+		span.GetBox(box);
+
+		int stack[64];
+		int stack_size = 0;
+		stack[stack_size++] = 0;
+		while(stack_size > 0)
+		{
+			const Node &node = m_nodes[stack[--stack_size]];
+			if(!BoxesTouch(node.m_box, box, Point::tolerance))continue;
+			if(node.m_count)
+			{
+				span.Intersect(&m_spans[node.m_first], node.m_count, pts);
+			}
+			else
+			{
+				stack[stack_size++] = node.m_children[0];
+				stack[stack_size++] = node.m_children[1];
+			}
+		}
+	}
+};
+
 void CArea::CurveIntersections(const CCurve& curve, std::list<Point> &pts)const
 {
 	// this returns all the intersections of this area with the given curve, ordered along the curve
-	std::list<Span> spans;
-	curve.GetSpans(spans);
-	for(auto &span : spans)
+	// the area's spans are put in a box tree, so each span of the curve is only tested against the spans near it
+	SpanBoxTree tree(*this);
+
+	std::list<Point> pts2;
+	std::multimap<double, Point> ordered_points;
+	const Point *prev_p = nullptr;
+	for(const auto &vertex : curve.m_vertices)
 	{
-		std::list<Point> pts2;
-		SpanIntersections(span, pts2);
-		for(auto &pt : pts2)
+		if(prev_p)
 		{
-			if(pts.size() == 0)
+			Span span(*prev_p, vertex);
+			pts2.clear();
+			tree.Intersect(span, pts2);
+
+			// order them along the span
+			ordered_points.clear();
+			for(auto &p : pts2)
 			{
-				pts.push_back(pt);
+				double t;
+				if(span.On(p, &t))
+				{
+					ordered_points.insert(std::make_pair(t, p));
+				}
 			}
-			else
+
+			for(auto &pair : ordered_points)
 			{
-				if(pt != pts.back())pts.push_back(pt);
+				if(pts.size() == 0 || pair.second != pts.back())pts.push_back(pair.second);
 			}
 		}
+		prev_p = &(vertex.m_p);
 	}
 }
 
@@ -32,7 +32,8 @@ struct CAreaPocketParams
 };
 
 struct CAreaProcessingContext {
-	bool fit_arcs = true;
+	bool fit_arcs = true; // FitArcs on the results of booleans and offsets, otherwise they are left as lines, as clipper made them
+	unsigned int fit_arcs_threads = 1; // threads fitting arcs to the curves of big boolean and offset results, 0 for one per hardware thread
 	bool please_abort = false;
 	double processing_done = 0.0;
 	double single_area_processing_length = 0.0;
@@ -40,25 +41,55 @@ struct CAreaProcessingContext {
 	double MakeOffsets_increment = 0.0;
 	double split_processing_length = 0.0;
 	bool set_processing_length_in_split = false;
+	bool simplify_before_booleans = false; // Simplify copies of the curves, to within the area's accuracy, before they go to clipper, for booleans and Offset
+	bool trust_ordered = false; // let Reorder and Split skip areas Offset, Thicken, Split or Reorder left ordered. only set it if curves aren't edited in place in between
 };
 
+#ifdef AREA_COUNTERS
+struct CAreaCounters {
+	// running totals, so callers can see how much work the invariant tracking saves
+	std::atomic<unsigned long> reorders_done{0};
+	std::atomic<unsigned long> reorders_skipped{0};
+	std::atomic<unsigned long> split_copies_skipped{0};
+
+	void Reset(){reorders_done = 0; reorders_skipped = 0; split_copies_skipped = 0;}
+};
+#endif
+
 class CArea
 {
+	// true while m_curves is known to be nested and oriented the way Reorder leaves it
+	// ( each anti-clockwise outside followed by its clockwise insides ).
+	// the curve count is remembered too, so curves pushed straight onto m_curves drop the state, but curves edited in place don't,
+	// so it is only acted on when the caller sets CAreaProcessingContext::trust_ordered, or by the pocketing code, for areas it has just made
+	bool m_ordered;
+	size_t m_ordered_num_curves;
+
+	void SplitInto(std::list<CArea> &areas, CAreaProcessingContext *ctx, bool trust_ordered)const;
+
 public:
     CArea(double accuracy);
     CArea(const CArea &rhs);
     std::list<CCurve> m_curves;
     double m_accuracy;
 
+#ifdef AREA_COUNTERS
+	static CAreaCounters counters;
+#endif
+
+	bool IsOrdered()const{return m_ordered && m_ordered_num_curves == m_curves.size();}
+	void SetOrdered(bool ordered){m_ordered = ordered; m_ordered_num_curves = m_curves.size();}
+
 	void append(const CCurve& curve);
-	void Subtract(const CArea& a2);
-	void Intersect(const CArea& a2);
-	void Union(const CArea& a2);
-	static CArea UniteCurves(std::list<CCurve> &curves, double accuracy);
-	void Xor(const CArea& a2);
-	void Offset(double inwards_value);
-	void Thicken(double value);
+	void Subtract(const CArea& a2, const CAreaProcessingContext *ctx = nullptr);
+	void Intersect(const CArea& a2, const CAreaProcessingContext *ctx = nullptr);
+	void Union(const CArea& a2, const CAreaProcessingContext *ctx = nullptr);
+	static CArea UniteCurves(std::list<CCurve> &curves, double accuracy, const CAreaProcessingContext *ctx = nullptr);
+	void Xor(const CArea& a2, const CAreaProcessingContext *ctx = nullptr);
+	void Offset(double inwards_value, const CAreaProcessingContext *ctx = nullptr);
+	void Thicken(double value, const CAreaProcessingContext *ctx = nullptr);
 	void FitArcs();
+	void Simplify(double tolerance);
 	size_t num_curves() const {return m_curves.size();}
 	Point NearestPoint(const Point& p)const;
 	void GetBox(CBox2D &box) const;
@@ -86,3 +117,4 @@ OverlapType GetOverlapType(const CCurve& c1, const CCurve& c2);
 OverlapType GetOverlapType(const CArea& a1, const CArea& a2);
 bool IsInside(const Point& p, const CCurve& c);
 bool IsInside(const Point& p, const CArea& a);
+void IsInside(const Point* pts, size_t num_pts, const CArea& a, bool* inside); // tests many points at once
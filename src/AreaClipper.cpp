@@ -4,6 +4,11 @@
 
 #include "Area.h"
 #include "clipper.hpp"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
 using namespace ClipperLib;
 
 using TPolygon = Path;
@@ -14,6 +19,10 @@ bool CArea::IsBoolean(){ return false; }
 //static const double PI = 3.1415926535897932;
 static constexpr double Clipper4Factor = 1000000.0;
 
+// below these, starting threads costs more than fitting arcs to the curves in one thread
+static constexpr size_t MinCurvesForThreads = 8;
+static constexpr size_t MinPointsForThreads = 20000;
+
 class DoubleAreaPoint
 {
 public:
@@ -285,12 +294,47 @@ static void OffsetSpansWithObrounds(const CArea& area, TPolyPolygon &pp_new, dou
 	}
 }
 
-static void MakePolyPoly( const CArea& area, TPolyPolygon &pp, double accuracy, bool reverse = true ){
+static const CCurve& CurveForClipper(const CCurve& curve, CCurve& simplified, double accuracy, bool simplify)
+{
+	// the curve, or a simplified copy of it
+	if(!simplify)return curve;
+	simplified = curve;
+	simplified.Simplify(accuracy);
+	return simplified;
+}
+
+static void MakePolylinePoly(const CCurve& curve, TPolygon &p, bool reverse)
+{
+	// a curve of lines only needs no flattening; the points after the first go straight in
+	size_t num_pts = (curve.m_vertices.size() > 1) ? curve.m_vertices.size() - 1 : 0;
+	p.resize(num_pts);
+	for(size_t i = 0; i < num_pts; i++)
+	{
+		const Point &pt = curve.m_vertices[i + 1].m_p;
+		p[reverse ? num_pts - 1 - i : i] = DoubleAreaPoint(pt.x, pt.y).int_point();
+	}
+}
+
+static bool SimplifyBeforeBooleans(const CAreaProcessingContext *ctx)
+{
+	return ctx && ctx->simplify_before_booleans;
+}
+
+static void MakePolyPoly( const CArea& area, TPolyPolygon &pp, double accuracy, bool reverse = true, bool simplify = false ){
 	pp.clear();
 
 	std::list<DoubleAreaPoint> pts;
-	for(const auto &curve : area.m_curves)
+	CCurve simplified;
+	for(const auto &area_curve : area.m_curves)
 	{
+		const CCurve &curve = CurveForClipper(area_curve, simplified, accuracy, simplify);
+		if(!curve.HasArcs())
+		{
+			pp.push_back(TPolygon());
+			MakePolylinePoly(curve, pp.back(), reverse);
+			continue;
+		}
+
 		pts.clear();
 		const CVertex* prev_vertex = nullptr;
 		for(const auto &vertex : curve.m_vertices)
@@ -324,8 +368,16 @@ static void MakePolyPoly( const CArea& area, TPolyPolygon &pp, double accuracy,
 	}
 }
 
-static void MakePoly(const CCurve& curve, TPolygon &p, double accuracy)
+static void MakePoly(const CCurve& curve_in, TPolygon &p, double accuracy, bool simplify)
 {
+	CCurve simplified;
+	const CCurve &curve = CurveForClipper(curve_in, simplified, accuracy, simplify);
+	if(!curve.HasArcs())
+	{
+		MakePolylinePoly(curve, p, false);
+		return;
+	}
+
 	std::list<DoubleAreaPoint> pts;
 	const CVertex* prev_vertex = nullptr;
 	for (const auto &vertex : curve.m_vertices)
@@ -347,77 +399,123 @@ static void MakePoly(const CCurve& curve, TPolygon &p, double accuracy)
 
 static void SetFromResult( CCurve& curve, const TPolygon& p, double accuracy, bool reverse = true, bool fit_arcs = true )
 {
-	for(unsigned int j = 0; j < p.size(); j++)
+	if(p.size() == 0)return;
+	curve.m_vertices.reserve(curve.m_vertices.size() + p.size() + 1);
+	for(unsigned int j = 0; j <= p.size(); j++)
 	{
-		const IntPoint &pt = p[j];
+		// the first point is repeated at the end; reversed, that's the first point at the start too
+		const IntPoint &pt = reverse ? p[(p.size() - j) % p.size()] : p[j % p.size()];
 		DoubleAreaPoint dp(pt);
-		CVertex vertex(CVertex::vt_line, Point(dp.X, dp.Y), Point(0.0, 0.0));
-		if(reverse)curve.m_vertices.push_front(vertex);
-		else curve.m_vertices.push_back(vertex);
+		curve.m_vertices.push_back(CVertex(CVertex::vt_line, Point(dp.X, dp.Y), Point(0.0, 0.0)));
 	}
-	// make a copy of the first point at the end
-	if(reverse)curve.m_vertices.push_front(curve.m_vertices.back());
-	else curve.m_vertices.push_back(curve.m_vertices.front());
 
 	if(fit_arcs)curve.FitArcs(accuracy);
 }
 
-static void SetFromResult( CArea& area, const TPolyPolygon& pp, double accuracy, bool reverse = true, bool fit_arcs = true )
+class CThreadJoiner
 {
+	// joins the threads when it goes out of scope, so none are left running if starting one throws
+	std::vector<std::thread> &m_threads;
+public:
+	CThreadJoiner(std::vector<std::thread> &threads):m_threads(threads){}
+	~CThreadJoiner(){for(auto &thread : m_threads)thread.join();}
+};
+
+static void SetFromResult( CArea& area, const TPolyPolygon& pp, double accuracy, bool reverse, const CAreaProcessingContext *ctx )
+{
+	bool fit_arcs = (ctx == nullptr || ctx->fit_arcs);
+
 	// delete existing geometry
 	area.m_curves.clear();
+	area.SetOrdered(false); // clipper's results come out unnested and with outsides clockwise
 
+	std::vector<CCurve*> curves;
+	curves.reserve(pp.size());
+	size_t num_points = 0;
 	for(unsigned int i = 0; i < pp.size(); i++)
 	{
-		const TPolygon& p = pp[i];
-
 		area.m_curves.push_back(CCurve());
-		CCurve &curve = area.m_curves.back();
-		SetFromResult(curve, p, accuracy, reverse, fit_arcs);
-    }
+		curves.push_back(&area.m_curves.back());
+		num_points += pp[i].size();
+	}
+
+	// the curves are independent, so, if the caller asks for threads, big results are shared out between them, a curve at a time
+	unsigned int num_threads = ctx ? ctx->fit_arcs_threads : 1;
+	if(num_threads == 0)num_threads = std::thread::hardware_concurrency();
+	if(!fit_arcs || num_threads < 2 || curves.size() < MinCurvesForThreads || num_points < MinPointsForThreads)
+	{
+		for(unsigned int i = 0; i < pp.size(); i++)SetFromResult(*curves[i], pp[i], accuracy, reverse, fit_arcs);
+		return;
+	}
+
+	std::atomic<size_t> next_curve{0};
+	std::mutex error_mutex;
+	std::exception_ptr error;
+	auto set_curves = [&]()
+	{
+		try
+		{
+			for(size_t i = next_curve++; i < curves.size(); i = next_curve++)SetFromResult(*curves[i], pp[i], accuracy, reverse, fit_arcs);
+		}
+		catch(...)
+		{
+			// kept for the calling thread to throw again, once the others have stopped
+			std::lock_guard<std::mutex> lock(error_mutex);
+			if(!error)error = std::current_exception();
+			next_curve = curves.size();
+		}
+	};
+	num_threads = std::min<size_t>(num_threads, curves.size());
+	{
+		std::vector<std::thread> threads;
+		CThreadJoiner joiner(threads);
+		for(unsigned int t = 1; t < num_threads; t++)threads.emplace_back(set_curves);
+		set_curves();
+	}
+	if(error)std::rethrow_exception(error);
 }
 
-void CArea::Subtract(const CArea& a2)
+void CArea::Subtract(const CArea& a2, const CAreaProcessingContext *ctx)
 {
 	Clipper c;
 	TPolyPolygon pp1, pp2;
-	MakePolyPoly(*this, pp1, m_accuracy);
-	MakePolyPoly(a2, pp2, m_accuracy);
+	MakePolyPoly(*this, pp1, m_accuracy, true, SimplifyBeforeBooleans(ctx));
+	MakePolyPoly(a2, pp2, m_accuracy, true, SimplifyBeforeBooleans(ctx));
 	c.AddPaths(pp1, ptSubject, true);
 	c.AddPaths(pp2, ptClip, true);
 	TPolyPolygon solution;
 	c.Execute(ctDifference, solution);
-	SetFromResult(*this, solution, m_accuracy);
+	SetFromResult(*this, solution, m_accuracy, true, ctx);
 }
 
-void CArea::Intersect(const CArea& a2)
+void CArea::Intersect(const CArea& a2, const CAreaProcessingContext *ctx)
 {
 	Clipper c;
 	TPolyPolygon pp1, pp2;
-	MakePolyPoly(*this, pp1, m_accuracy);
-	MakePolyPoly(a2, pp2, m_accuracy);
+	MakePolyPoly(*this, pp1, m_accuracy, true, SimplifyBeforeBooleans(ctx));
+	MakePolyPoly(a2, pp2, m_accuracy, true, SimplifyBeforeBooleans(ctx));
 	c.AddPaths(pp1, ptSubject, true);
 	c.AddPaths(pp2, ptClip, true);
 	TPolyPolygon solution;
 	c.Execute(ctIntersection, solution);
-	SetFromResult(*this, solution, m_accuracy);
+	SetFromResult(*this, solution, m_accuracy, true, ctx);
 }
 
-void CArea::Union(const CArea& a2)
+void CArea::Union(const CArea& a2, const CAreaProcessingContext *ctx)
 {
 	Clipper c;
 	TPolyPolygon pp1, pp2;
-	MakePolyPoly(*this, pp1, m_accuracy);
-	MakePolyPoly(a2, pp2, m_accuracy);
+	MakePolyPoly(*this, pp1, m_accuracy, true, SimplifyBeforeBooleans(ctx));
+	MakePolyPoly(a2, pp2, m_accuracy, true, SimplifyBeforeBooleans(ctx));
 	c.AddPaths(pp1, ptSubject, true);
 	c.AddPaths(pp2, ptClip, true);
 	TPolyPolygon solution;
 	c.Execute(ctUnion, solution);
-	SetFromResult(*this, solution, m_accuracy);
+	SetFromResult(*this, solution, m_accuracy, true, ctx);
 }
 
 // static
-CArea CArea::UniteCurves(std::list<CCurve> &curves, double accuracy)
+CArea CArea::UniteCurves(std::list<CCurve> &curves, double accuracy, const CAreaProcessingContext *ctx)
 {
 	Clipper c;
 
@@ -426,7 +524,7 @@ CArea CArea::UniteCurves(std::list<CCurve> &curves, double accuracy)
 	for (auto &curve : curves)
 	{
 		TPolygon p;
-		MakePoly(curve, p, accuracy);
+		MakePoly(curve, p, accuracy, SimplifyBeforeBooleans(ctx));
 		pp.push_back(p);
 	}
 
@@ -434,37 +532,37 @@ CArea CArea::UniteCurves(std::list<CCurve> &curves, double accuracy)
 	TPolyPolygon solution;
 	c.Execute(ctUnion, solution, pftNonZero, pftNonZero);
 	CArea area(accuracy);
-	SetFromResult(area, solution, accuracy);
+	SetFromResult(area, solution, accuracy, true, ctx);
 	return area;
 }
 
-void CArea::Xor(const CArea& a2)
+void CArea::Xor(const CArea& a2, const CAreaProcessingContext *ctx)
 {
 	Clipper c;
 	TPolyPolygon pp1, pp2;
-	MakePolyPoly(*this, pp1, m_accuracy);
-	MakePolyPoly(a2, pp2, m_accuracy);
+	MakePolyPoly(*this, pp1, m_accuracy, true, SimplifyBeforeBooleans(ctx));
+	MakePolyPoly(a2, pp2, m_accuracy, true, SimplifyBeforeBooleans(ctx));
 	c.AddPaths(pp1, ptSubject, true);
 	c.AddPaths(pp2, ptClip, true);
 	TPolyPolygon solution;
 	c.Execute(ctXor, solution);
-	SetFromResult(*this, solution, m_accuracy);
+	SetFromResult(*this, solution, m_accuracy, true, ctx);
 }
 
-void CArea::Offset(double inwards_value)
+void CArea::Offset(double inwards_value, const CAreaProcessingContext *ctx)
 {
 	TPolyPolygon pp, pp2;
-	MakePolyPoly(*this, pp, m_accuracy, false);
+	MakePolyPoly(*this, pp, m_accuracy, false, SimplifyBeforeBooleans(ctx));
 	OffsetWithLoops(pp, pp2, inwards_value);
-	SetFromResult(*this, pp2, m_accuracy, false);
+	SetFromResult(*this, pp2, m_accuracy, false, ctx);
 	this->Reorder();
 }
 
-void CArea::Thicken(double value)
+void CArea::Thicken(double value, const CAreaProcessingContext *ctx)
 {
 	TPolyPolygon pp;
 	OffsetSpansWithObrounds(*this, pp, value);
-	SetFromResult(*this, pp, m_accuracy, false);
+	SetFromResult(*this, pp, m_accuracy, false, ctx);
 	this->Reorder();
 }
 
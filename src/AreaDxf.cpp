@@ -4,28 +4,712 @@
 
 #include "AreaDxf.h"
 #include "Area.h"
+#include "BulgeCurve.h"
 
-AreaDxfRead::AreaDxfRead(CArea* area, const char* filepath):CDxfRead(filepath), m_area(area){}
+
+// the points at the ends of curves, in a grid, so that the point == another is found without looking at all of them.
+// the cells are four times Point::tolerance wide, so most points only need their own cell looking in.
+// the cells with points are kept in an open addressed hash table, which never needs to grow, as its size is known
+class CEndPoints
+{
+	struct Cell
+	{
+		long long ix, iy;
+		int last; // the last point added to the cell, -1 for an empty slot
+	};
+	std::vector<Cell> m_cells;
+	size_t m_mask;
+	std::vector<int> m_next; // the point added before, in the same cell, or -1
+	std::vector<Point> m_points;
+
+	static constexpr double CellSize = 4 * Point::tolerance;
+
+	Cell& Slot(long long ix, long long iy)
+	{
+		// the cell's slot, or the empty one where it would go
+		unsigned long long h = (static_cast<unsigned long long>(ix) * 0x9E3779B97F4A7C15ULL) ^ (static_cast<unsigned long long>(iy) * 0xC2B2AE3D27D4EB4FULL);
+		for(size_t i = (h ^ (h >> 29)) & m_mask;; i = (i + 1) & m_mask)
+		{
+			Cell &cell = m_cells[i];
+			if(cell.last < 0 || (cell.ix == ix && cell.iy == iy))return cell;
+		}
+	}
+
+	int FindInCell(long long ix, long long iy, const Point& p)
+	{
+		for(int k = Slot(ix, iy).last; k >= 0; k = m_next[k])
+		{
+			if(m_points[k] == p)return k;
+		}
+		return -1;
+	}
+
+public:
+	CEndPoints(size_t num_points)
+	{
+		size_t num_slots = 16;
+		while(num_slots < 2 * num_points)num_slots *= 2;
+		m_cells.resize(num_slots, Cell{0, 0, -1});
+		m_mask = num_slots - 1;
+		m_next.reserve(num_points);
+		m_points.reserve(num_points);
+	}
+
+	size_t size()const{return m_points.size();}
+
+	int Find(const Point& p)
+	{
+		// the index of a point == p, added if there isn't one
+		double fx = floor(p.x / CellSize);
+		double fy = floor(p.y / CellSize);
+		long long ix = static_cast<long long>(fx);
+		long long iy = static_cast<long long>(fy);
+		int k = FindInCell(ix, iy, p);
+		if(k < 0)
+		{
+			// the neighbouring cells, on the sides p is near
+			double dx = p.x - fx * CellSize;
+			double dy = p.y - fy * CellSize;
+			long long nx = (dx < Point::tolerance) ? ix - 1 : ((dx > CellSize - Point::tolerance) ? ix + 1 : ix);
+			long long ny = (dy < Point::tolerance) ? iy - 1 : ((dy > CellSize - Point::tolerance) ? iy + 1 : iy);
+			if(nx != ix)k = FindInCell(nx, iy, p);
+			if(k < 0 && ny != iy)k = FindInCell(ix, ny, p);
+			if(k < 0 && nx != ix && ny != iy)k = FindInCell(nx, ny, p);
+		}
+		if(k >= 0)return k;
+
+		int index = static_cast<int>(m_points.size());
+		m_points.push_back(p);
+		Cell &cell = Slot(ix, iy);
+		cell.ix = ix;
+		cell.iy = iy;
+		m_next.push_back(cell.last);
+		cell.last = index;
+		return index;
+	}
+};
+
+// a SPLINE's NURBS curve, in the xy plane, for points and tangents along it
+class CNurbs
+{
+	int m_degree;
+	size_t m_num_points;
+	const std::vector<double>& m_knots;
+	std::vector<double> m_points; // each control point's x and y, multiplied by its weight, then its weight
+	mutable std::vector<double> m_work; // de Boor's points
+
+public:
+	CNurbs(const SplineData& sd);
+
+	bool Valid()const;
+	int FirstSpan()const{return m_degree;}
+	int EndSpan()const{return static_cast<int>(m_num_points);}
+	double Knot(int i)const{return m_knots[i];}
+	void Evaluate(int span, double t, Point& p, Point& v)const; // the point at t, in the given knot span, and the direction there
+};
+
+CNurbs::CNurbs(const SplineData& sd):m_degree(sd.degree), m_knots(sd.knot)
+{
+	m_num_points = std::min(sd.controlx.size(), sd.controly.size());
+	bool weighted = (sd.weight.size() == m_num_points);
+	m_points.reserve(3 * m_num_points);
+	for(size_t i = 0; i < m_num_points; i++)
+	{
+		double w = weighted ? sd.weight[i] : 1.0;
+		m_points.push_back(sd.controlx[i] * w);
+		m_points.push_back(sd.controly[i] * w);
+		m_points.push_back(w);
+	}
+	if(m_degree > 0)m_work.resize(3 * (m_degree + 1));
+}
+
+bool CNurbs::Valid()const
+{
+	if(m_degree < 1 || m_num_points < static_cast<size_t>(m_degree) + 1 || m_knots.size() != m_num_points + m_degree + 1)return false;
+	for(size_t i = 1; i < m_knots.size(); i++)
+	{
+		if(!(m_knots[i] >= m_knots[i - 1]))return false;
+	}
+	for(size_t i = 0; i < m_num_points; i++)
+	{
+		if(!(m_points[3 * i + 2] > 0.0))return false;
+	}
+	return m_knots[m_degree] < m_knots[m_num_points];
+}
+
+void CNurbs::Evaluate(int span, double t, Point& p, Point& v)const
+{
+	// de Boor's algorithm, in homogeneous coordinates. the derivative is p / (knot span length) times the difference
+	// of the last two points before the last step, then the weight's part is taken out of it
+	int deg = m_degree;
+	double* d = m_work.data();
+	std::copy(m_points.begin() + 3 * (span - deg), m_points.begin() + 3 * (span + 1), d);
+	double dx = 0.0, dy = 0.0, dw = 0.0;
+	for(int r = 1; r <= deg; r++)
+	{
+		if(r == deg)
+		{
+			double f = deg / (m_knots[span + 1] - m_knots[span]);
+			dx = (d[3 * deg] - d[3 * deg - 3]) * f;
+			dy = (d[3 * deg + 1] - d[3 * deg - 2]) * f;
+			dw = (d[3 * deg + 2] - d[3 * deg - 1]) * f;
+		}
+		for(int j = deg; j >= r; j--)
+		{
+			double k0 = m_knots[j + span - deg];
+			double a = (t - k0) / (m_knots[j + 1 + span - r] - k0);
+			for(int c = 0; c < 3; c++)d[3 * j + c] = (1.0 - a) * d[3 * j - 3 + c] + a * d[3 * j + c];
+		}
+	}
+	double w = d[3 * deg + 2];
+	p = Point(d[3 * deg] / w, d[3 * deg + 1] / w);
+	v = Point((dx - dw * p.x) / w, (dy - dw * p.y) / w);
+}
+
+// fits lines, or biarcs, to a NURBS a knot span at a time, halving the parameter range until they are within tolerance
+class CSplineFit
+{
+	static const int Samples = 8; // points on the spline checked against each fit
+	static const int MaxDepth = 16;
+
+	const CNurbs& m_nurbs;
+	double m_tolerance;
+	bool m_arcs;
+	CCurve& m_curve;
+
+	bool Near(int span, double t0, double t1, const Span* spans, int num_spans)const;
+	bool Biarc(const Point& p0, const Point& t0, const Point& p1, const Point& t1, CVertex& v0, CVertex& v1)const;
+	CVertex ArcVertex(const Point& tangent_point, const Point& tangent, const Point& other, const Point& end)const;
+	void Append(const CVertex& v);
+
+public:
+	CSplineFit(const CNurbs& nurbs, double tolerance, bool arcs, CCurve& curve):m_nurbs(nurbs), m_tolerance(tolerance), m_arcs(arcs), m_curve(curve){}
+
+	void Fit(int span, double t0, const Point& p0, Point v0, double t1, const Point& p1, Point v1, int depth = 0);
+};
+
+bool CSplineFit::Near(int span, double t0, double t1, const Span* spans, int num_spans)const
+{
+	// true if the spline's points between t0 and t1 are all within tolerance of the spans
+	for(int i = 1; i <= Samples; i++)
+	{
+		Point p, v;
+		m_nurbs.Evaluate(span, t0 + (t1 - t0) * i / (Samples + 1), p, v);
+		double d = p.dist(spans[0].NearestPoint(p));
+		for(int k = 1; k < num_spans && d > m_tolerance; k++)d = std::min(d, p.dist(spans[k].NearestPoint(p)));
+		if(!(d <= m_tolerance))return false;
+	}
+	return true;
+}
+
+CVertex CSplineFit::ArcVertex(const Point& tangent_point, const Point& tangent, const Point& other, const Point& end)const
+{
+	// the arc, ending at end, through tangent_point, in the direction tangent there, and through other.
+	// the centre is along the normal at tangent_point, as far from it as from other. a very flat arc is a line
+	Point n = ~tangent;
+	Point v = other - tangent_point;
+	double nv = n * v;
+	if(fabs(nv) < m_tolerance * 1.0e-3)return CVertex(end);
+	double r = (v * v) / (2.0 * nv);
+	return CVertex((r > 0) ? CVertex::vt_ccw_arc : CVertex::vt_cw_arc, end, tangent_point + n * r);
+}
+
+bool CSplineFit::Biarc(const Point& p0, const Point& t0, const Point& p1, const Point& t1, CVertex& v0, CVertex& v1)const
+{
+	// two arcs, from p0 in direction t0 to p1 in direction t1, meeting with the same tangent at j.
+	// j is half way between p0 + d t0 and p1 - d t1, which are 2d apart, so (t.t - 4)d² - 2(v.t)d + v.v = 0
+	Point v = p1 - p0;
+	Point t = t0 + t1;
+	double vt = v * t;
+	double a = t * t - 4.0;
+	double d;
+	if(a > -1.0e-12)
+	{
+		// parallel tangents
+		if(vt <= 0.0)return false;
+		d = (v * v) / (2.0 * vt);
+	}
+	else
+	{
+		d = (vt - sqrt(vt * vt - a * (v * v))) / a;
+	}
+	if(!(d > 0.0))return false;
+
+	Point j = (p0 + t0 * d + p1 - t1 * d) * 0.5;
+	v0 = ArcVertex(p0, t0, j, j);
+	v1 = ArcVertex(p1, t1, j, p1);
+
+	// arcs of more than a right angle aren't wanted; the spline is split instead
+	const double max_angle = 1.5707963267948966;
+	if(v0.m_type != CVertex::vt_line && fabs(Span(p0, v0).IncludedAngle()) > max_angle)return false;
+	if(v1.m_type != CVertex::vt_line && fabs(Span(j, v1).IncludedAngle()) > max_angle)return false;
+	return true;
+}
+
+void CSplineFit::Fit(int span, double t0, const Point& p0, Point v0, double t1, const Point& p1, Point v1, int depth)
+{
+	if(depth < MaxDepth)
+	{
+		bool v0_known = (v0.normalize() > 1.0e-15);
+		bool v1_known = (v1.normalize() > 1.0e-15);
+		if(!v0_known || !v1_known)
+		{
+			// no direction where control points are repeated; the chord's is used
+			Point c = p1 - p0;
+			c.normalize();
+			if(!v0_known)v0 = c;
+			if(!v1_known)v1 = c;
+		}
+
+		if(m_arcs)
+		{
+			CVertex a0, a1;
+			if(v0.length() > 0.5 && v1.length() > 0.5 && Biarc(p0, v0, p1, v1, a0, a1))
+			{
+				Span spans[2] = {Span(p0, a0), Span(a0.m_p, a1)};
+				if(Near(span, t0, t1, spans, 2))
+				{
+					Append(a0);
+					Append(a1);
+					return;
+				}
+			}
+		}
+		else
+		{
+			Span line(p0, CVertex(p1));
+			if(Near(span, t0, t1, &line, 1))
+			{
+				Append(CVertex(p1));
+				return;
+			}
+		}
+
+		double tm = (t0 + t1) * 0.5;
+		Point pm, vm;
+		m_nurbs.Evaluate(span, tm, pm, vm);
+		Fit(span, t0, p0, v0, tm, pm, vm, depth + 1);
+		Fit(span, tm, pm, vm, t1, p1, v1, depth + 1);
+		return;
+	}
+
+	// as near as it gets
+	Append(CVertex(p1));
+}
+
+void CSplineFit::Append(const CVertex& v)
+{
+	// a line going on along the last line, or an arc going on round the last arc's circle, makes that longer
+	std::vector<CVertex>& vertices = m_curve.m_vertices;
+	if(v.m_p == vertices.back().m_p)return;
+	if(vertices.size() >= 2)
+	{
+		CVertex& last = vertices.back();
+		const Point& last_start = vertices[vertices.size() - 2].m_p;
+		double same = m_tolerance * 1.0e-3;
+		if(v.m_type == CVertex::vt_line && last.m_type == CVertex::vt_line)
+		{
+			Span chord(last_start, v);
+			if(last.m_p.dist(chord.NearestPoint(last.m_p)) < same && (last.m_p - last_start) * (v.m_p - last.m_p) > 0.0)
+			{
+				last.m_p = v.m_p;
+				return;
+			}
+		}
+		else if(v.m_type != CVertex::vt_line && v.m_type == last.m_type && v.m_c.dist(last.m_c) < same &&
+			fabs(last.m_p.dist(v.m_c) - v.m_p.dist(v.m_c)) < same)
+		{
+			double angle = fabs(Span(last_start, last).IncludedAngle()) + fabs(Span(last.m_p, v).IncludedAngle());
+			if(angle < 6.0)
+			{
+				last.m_p = v.m_p;
+				return;
+			}
+		}
+	}
+	vertices.push_back(v);
+}
+
+// an INSERT's placing of its block: scaled, and rotated, about the block's base point, which is moved to the insertion point.
+// an INSERT in a block multiplies these together, which can give a shear, so the whole 2d affine transform is kept
+class CInsertTransform
+{
+	double m_m[6]; // x' = m0 x + m1 y + m2, y' = m3 x + m4 y + m5
+
+public:
+	CInsertTransform(const Point& point, double scale_x, double scale_y, double rotation, const Point& base);
+	CInsertTransform(const CInsertTransform& outer, const CInsertTransform& inner); // inner, then outer
+
+	Point operator()(const Point& p)const{return Point(m_m[0] * p.x + m_m[1] * p.y + m_m[2], m_m[3] * p.x + m_m[4] * p.y + m_m[5]);}
+	bool KeepsArcs(bool& mirror)const; // true if circles stay circles, and mirror if their directions turn round
+	double MaxScale()const{return sqrt(m_m[0] * m_m[0] + m_m[1] * m_m[1] + m_m[3] * m_m[3] + m_m[4] * m_m[4]);} // no length grows by more
+};
+
+CInsertTransform::CInsertTransform(const Point& point, double scale_x, double scale_y, double rotation, const Point& base)
+{
+	double c = cos(rotation);
+	double s = sin(rotation);
+	m_m[0] = c * scale_x;
+	m_m[1] = -s * scale_y;
+	m_m[3] = s * scale_x;
+	m_m[4] = c * scale_y;
+	m_m[2] = point.x - (m_m[0] * base.x + m_m[1] * base.y);
+	m_m[5] = point.y - (m_m[3] * base.x + m_m[4] * base.y);
+}
+
+CInsertTransform::CInsertTransform(const CInsertTransform& outer, const CInsertTransform& inner)
+{
+	const double* a = outer.m_m;
+	const double* b = inner.m_m;
+	m_m[0] = a[0] * b[0] + a[1] * b[3];
+	m_m[1] = a[0] * b[1] + a[1] * b[4];
+	m_m[2] = a[0] * b[2] + a[1] * b[5] + a[2];
+	m_m[3] = a[3] * b[0] + a[4] * b[3];
+	m_m[4] = a[3] * b[1] + a[4] * b[4];
+	m_m[5] = a[3] * b[2] + a[4] * b[5] + a[5];
+}
+
+bool CInsertTransform::KeepsArcs(bool& mirror)const
+{
+	// a rotation and the same scale each way, which may be mirrored
+	double same = 1.0e-9 * MaxScale();
+	mirror = false;
+	if(fabs(m_m[0] - m_m[4]) < same && fabs(m_m[1] + m_m[3]) < same)return true;
+	mirror = true;
+	return fabs(m_m[0] + m_m[4]) < same && fabs(m_m[1] - m_m[3]) < same;
+}
+
+AreaDxfWrite::AreaDxfWrite(const char* filepath, bool binary):CDxfWrite(filepath, binary), m_polylines(true){}
+
+void AreaDxfWrite::WriteCurve(const CCurve& curve, const char* layer_name)
+{
+	if(curve.m_vertices.size() < 2)return;
+
+	if(!m_polylines)
+	{
+		const Point* prev_p = nullptr;
+		for(const auto &vertex : curve.m_vertices)
+		{
+			if(prev_p)
+			{
+				double s[3] = {prev_p->x, prev_p->y, 0.0};
+				double e[3] = {vertex.m_p.x, vertex.m_p.y, 0.0};
+				if(vertex.m_type == CVertex::vt_line)
+				{
+					WriteLine(s, e, layer_name);
+				}
+				else
+				{
+					double c[3] = {vertex.m_c.x, vertex.m_c.y, 0.0};
+					WriteArc(s, e, c, vertex.m_type == CVertex::vt_ccw_arc, layer_name);
+				}
+			}
+			prev_p = &(vertex.m_p);
+		}
+		return;
+	}
+
+	// a LWPOLYLINE's bulge is that of the span from its vertex, so the bulges are one behind the vertices' types.
+	// a closed curve leaves out its last point, which is its first again
+	m_xy.clear();
+	m_bulges.clear();
+	const Point* prev_p = nullptr;
+	for(const auto &vertex : curve.m_vertices)
+	{
+		if(prev_p)m_bulges.push_back(CBulgeCurve::Bulge(Span(*prev_p, vertex)));
+		m_xy.push_back(vertex.m_p.x);
+		m_xy.push_back(vertex.m_p.y);
+		prev_p = &(vertex.m_p);
+	}
+	bool closed = curve.IsClosed();
+	if(closed)m_xy.resize(m_xy.size() - 2);
+	else m_bulges.push_back(0.0);
+	WriteLwPolyLine(m_xy.data(), m_bulges.data(), static_cast<int>(m_xy.size() / 2), closed, layer_name);
+}
+
+void AreaDxfWrite::WriteCurves(const std::list<CCurve>& curves, const char* layer_name)
+{
+	for(const auto &curve : curves)WriteCurve(curve, layer_name);
+}
+
+void AreaDxfWrite::WriteArea(const CArea& area, const char* layer_name)
+{
+	WriteCurves(area.m_curves, layer_name);
+}
+
+AreaDxfRead::AreaDxfRead(CArea* area, const char* filepath):CDxfRead(filepath), m_first_curve(area->m_curves.size()), m_curves(&area->m_curves), m_block(nullptr),
+	m_area(area), m_join_curves(true), m_spline_arcs(true), m_expand_inserts(true){}
 
 void AreaDxfRead::StartCurveIfNecessary(const double* s)
 {
 	Point ps(s);
-	if((m_area->m_curves.size() == 0) || (m_area->m_curves.back().m_vertices.size() == 0) || (m_area->m_curves.back().m_vertices.back().m_p != ps))
+	if((m_curves->size() == 0) || (m_curves->back().m_vertices.size() == 0) || (m_curves->back().m_vertices.back().m_p != ps))
 	{
 		// start a new curve
-		m_area->m_curves.push_back(CCurve());
-		m_area->m_curves.back().m_vertices.push_back(ps);
+		m_curves->push_back(CCurve());
+		m_curves->back().m_vertices.push_back(ps);
 	}
 }
 
 void AreaDxfRead::OnReadLine(const double* s, const double* e)
 {
 	StartCurveIfNecessary(s);
-	m_area->m_curves.back().m_vertices.push_back(Point(e));
+	m_curves->back().m_vertices.push_back(Point(e));
 }
 
 void AreaDxfRead::OnReadArc(const double* s, const double* e, const double* c, bool dir)
 {
 	StartCurveIfNecessary(s);
-	m_area->m_curves.back().m_vertices.push_back(CVertex(dir?CVertex::vt_ccw_arc:CVertex::vt_cw_arc, Point(e), Point(c)));
+	m_curves->back().m_vertices.push_back(CVertex(dir?CVertex::vt_ccw_arc:CVertex::vt_cw_arc, Point(e), Point(c)));
+}
+
+void AreaDxfRead::OnReadCircle(const double* s, const double* c, bool dir)
+{
+	// a closed curve of its own, of two half circles
+	Point ps(s);
+	Point pc(c);
+	CVertex::Type type = dir ? CVertex::vt_ccw_arc : CVertex::vt_cw_arc;
+	m_curves->push_back(CCurve());
+	std::vector<CVertex> &vertices = m_curves->back().m_vertices;
+	vertices.push_back(CVertex(ps));
+	vertices.push_back(CVertex(type, pc * 2.0 - ps, pc));
+	vertices.push_back(CVertex(type, ps, pc));
+}
+
+void AreaDxfRead::OnReadSpline(struct SplineData& sd)
+{
+	CNurbs nurbs(sd);
+	if(!nurbs.Valid())
+	{
+		// with no curve to follow, the fit points, or else the control points, are joined with lines
+		bool fit = (sd.fitx.size() >= 2);
+		const std::vector<double> &x = fit ? sd.fitx : sd.controlx;
+		const std::vector<double> &y = fit ? sd.fity : sd.controly;
+		for(size_t i = 1; i < std::min(x.size(), y.size()); i++)
+		{
+			double s[3] = {x[i - 1], y[i - 1], 0.0};
+			double e[3] = {x[i], y[i], 0.0};
+			OnReadLine(s, e);
+		}
+		return;
+	}
+
+	// each knot span is fitted on its own, as the spline may have a corner at a knot
+	Point p0, v0, p1, v1;
+	nurbs.Evaluate(nurbs.FirstSpan(), nurbs.Knot(nurbs.FirstSpan()), p0, v0);
+	double s[3] = {p0.x, p0.y, 0.0};
+	StartCurveIfNecessary(s);
+	CSplineFit fit(nurbs, m_area->m_accuracy, m_spline_arcs, m_curves->back());
+	for(int span = nurbs.FirstSpan(); span < nurbs.EndSpan(); span++)
+	{
+		double t0 = nurbs.Knot(span);
+		double t1 = nurbs.Knot(span + 1);
+		if(!(t1 > t0))continue;
+		Point p;
+		nurbs.Evaluate(span, t0, p, v0);
+		nurbs.Evaluate(span, t1, p1, v1);
+		fit.Fit(span, t0, p0, v0, t1, p1, v1);
+		p0 = p1;
+	}
+}
+
+void AreaDxfRead::OnReadInsert(const double* point, const double* scale, const char* name, double rotation)
+{
+	if(!m_expand_inserts)return;
+	Insert insert = {name, Point(point), scale[0], scale[1], rotation};
+	if(m_block)m_block->inserts.push_back(insert); // added with the block, as the block it inserts may not be read yet
+	else if(m_blocks.count(insert.name))AddInsert(insert, nullptr, 0);
+	else m_later_inserts.push_back(insert);
+}
+
+void AreaDxfRead::OnReadBlock(const char* name, const double* base)
+{
+	if(!m_expand_inserts)return;
+	Block &block = m_blocks[name];
+	block.base = Point(base);
+	block.curves.clear();
+	block.inserts.clear();
+	m_block = &block;
+	m_curves = &block.curves;
+}
+
+void AreaDxfRead::OnReadEndBlock()
+{
+	if(!m_block)return;
+	// joined once here, rather than in every copy
+	if(m_join_curves)JoinCurves(m_block->curves, 0);
+	m_block = nullptr;
+	m_curves = &m_area->m_curves;
+}
+
+void AreaDxfRead::AddInsert(const Insert& insert, const CInsertTransform* outer, int depth)const
+{
+	// the block's curves are copied into m_area, through the INSERT's transform, then the INSERTs in the block are added
+	const int MaxDepth = 16; // beyond this, a block is taken to be in itself
+	std::map<std::string, Block>::const_iterator It = m_blocks.find(insert.name);
+	if(It == m_blocks.end() || depth > MaxDepth)return;
+	const Block &block = It->second;
+
+	CInsertTransform transform(insert.point, insert.scale_x, insert.scale_y, insert.rotation, block.base);
+	if(outer)transform = CInsertTransform(*outer, transform);
+	double max_scale = transform.MaxScale();
+	if(!(max_scale > 0.0))return;
+	bool mirror;
+	bool keeps_arcs = transform.KeepsArcs(mirror);
+
+	CCurve lines;
+	for(const auto &curve : block.curves)
+	{
+		const CCurve* from = &curve;
+		if(!keeps_arcs && curve.HasArcs())
+		{
+			// stretched one way more than the other, an arc would be part of an ellipse, so it becomes lines
+			lines = curve;
+			lines.UnFitArcs(m_area->m_accuracy / max_scale);
+			from = &lines;
+		}
+		m_area->m_curves.push_back(CCurve());
+		std::vector<CVertex> &vertices = m_area->m_curves.back().m_vertices;
+		vertices.reserve(from->m_vertices.size());
+		for(const auto &v : from->m_vertices)
+		{
+			if(v.m_type == CVertex::vt_line)vertices.push_back(CVertex(transform(v.m_p)));
+			else vertices.push_back(CVertex(mirror ? reverseArcType(v.m_type) : v.m_type, transform(v.m_p), transform(v.m_c)));
+		}
+	}
+
+	for(const auto &inner : block.inserts)AddInsert(inner, &transform, depth + 1);
+}
+
+void AreaDxfRead::AddGraphics() const
+{
+	for(const auto &insert : m_later_inserts)AddInsert(insert, nullptr, 0);
+	if(m_join_curves)JoinCurves(m_area->m_curves, m_first_curve);
+}
+
+void AreaDxfRead::JoinCurves(std::list<CCurve>& area_curves, size_t first_curve)
+{
+	// the lines and arcs were added to the last curve when they started at its end; now curves whose ends meet are joined,
+	// turning them round where needed, through a map of their end points, so a file in any order gives whole curves.
+	// a joined curve takes the place of the first of its parts that was read
+	std::vector<std::list<CCurve>::iterator> curves;
+	std::list<CCurve>::iterator first = area_curves.begin();
+	std::advance(first, first_curve);
+	for(std::list<CCurve>::iterator It = first; It != area_curves.end(); It++)curves.push_back(It);
+
+	// the end points of the open curves; -1 for closed ones
+	CEndPoints end_points(2 * curves.size());
+	std::vector<int> start_point(curves.size(), -1);
+	std::vector<int> end_point(curves.size(), -1);
+	for(size_t i = 0; i < curves.size(); i++)
+	{
+		const CCurve &curve = *curves[i];
+		if(curve.m_vertices.size() < 2 || curve.IsClosed())continue;
+		int s = end_points.Find(curve.m_vertices.front().m_p);
+		int e = end_points.Find(curve.m_vertices.back().m_p);
+		if(s == e)continue;
+		start_point[i] = s;
+		end_point[i] = e;
+	}
+	if(end_points.size() == 0)return;
+
+	// the open curves at each point, in the order they were read
+	std::vector<int> first_at(end_points.size() + 1, 0);
+	for(size_t i = 0; i < curves.size(); i++)
+	{
+		if(start_point[i] < 0)continue;
+		first_at[start_point[i] + 1]++;
+		first_at[end_point[i] + 1]++;
+	}
+	for(size_t i = 1; i < first_at.size(); i++)first_at[i] += first_at[i - 1];
+	std::vector<int> curves_at(first_at.back());
+	std::vector<int> next_at(first_at.begin(), first_at.end() - 1);
+	for(size_t i = 0; i < curves.size(); i++)
+	{
+		if(start_point[i] < 0)continue;
+		curves_at[next_at[start_point[i]]++] = static_cast<int>(i);
+		curves_at[next_at[end_point[i]]++] = static_cast<int>(i);
+	}
+
+	std::vector<char> used(curves.size(), 0);
+	next_at.assign(first_at.begin(), first_at.end() - 1);
+	auto unused_curve_at = [&](int point)
+	{
+		// used curves are passed over once, so finding all the joins takes linear time
+		for(; next_at[point] < first_at[point + 1]; next_at[point]++)
+		{
+			int c = curves_at[next_at[point]];
+			if(!used[c])return c;
+		}
+		return -1;
+	};
+
+	std::vector<std::pair<int, bool>> before, after; // curves going back from a curve's start, and on from its end; true for those to be turned round
+	for(size_t i = 0; i < curves.size(); i++)
+	{
+		if(used[i] || start_point[i] < 0)continue;
+		used[i] = 1;
+
+		before.clear();
+		after.clear();
+		bool closed = false;
+		int point = start_point[i];
+		for(int c = unused_curve_at(point); c >= 0; c = unused_curve_at(point))
+		{
+			used[c] = 1;
+			bool reverse = (end_point[c] != point);
+			before.push_back(std::make_pair(c, reverse));
+			point = reverse ? end_point[c] : start_point[c];
+			if(point == end_point[i]){closed = true; break;}
+		}
+		int chain_start = point;
+		point = end_point[i];
+		while(!closed)
+		{
+			int c = unused_curve_at(point);
+			if(c < 0)break;
+			used[c] = 1;
+			bool reverse = (start_point[c] != point);
+			after.push_back(std::make_pair(c, reverse));
+			point = reverse ? start_point[c] : end_point[c];
+			if(point == chain_start)closed = true;
+		}
+		if(before.empty() && after.empty())continue;
+
+		std::vector<CVertex> vertices;
+		auto add = [&](int c, bool reverse)
+		{
+			const std::vector<CVertex> &v = curves[c]->m_vertices;
+			size_t n = v.size();
+			if(vertices.empty())vertices.push_back(CVertex(v[reverse ? n - 1 : 0].m_p));
+			if(reverse)
+			{
+				// as CCurve::Reverse does
+				for(size_t k = n - 1; k > 0; k--)
+				{
+					const CVertex &span_end = v[k];
+					if(span_end.m_type == CVertex::vt_line)vertices.push_back(CVertex(v[k - 1].m_p));
+					else vertices.push_back(CVertex(reverseArcType(span_end.m_type), v[k - 1].m_p, span_end.m_c));
+				}
+			}
+			else vertices.insert(vertices.end(), v.begin() + 1, v.end());
+			if(c != static_cast<int>(i))area_curves.erase(curves[c]);
+		};
+		for(std::vector<std::pair<int, bool>>::reverse_iterator It = before.rbegin(); It != before.rend(); It++)add(It->first, It->second);
+		add(static_cast<int>(i), false);
+		for(const auto &c : after)add(c.first, c.second);
+		curves[i]->m_vertices.swap(vertices);
+	}
+}
+
+size_t AreaDxfRead::NumOpenCurves()const
+{
+	size_t num_open = 0;
+	std::list<CCurve>::const_iterator It = m_area->m_curves.begin();
+	std::advance(It, m_first_curve);
+	for(; It != m_area->m_curves.end(); It++)
+	{
+		if(!It->IsClosed())num_open++;
+	}
+	return num_open;
 }
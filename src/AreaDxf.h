@@ -5,19 +5,69 @@
 #pragma once
 
 #include "dxf.h"
+#include "Curve.h"
 
 class CSketch;
 class CArea;
-class CCurve;
+class CInsertTransform;
 
 class AreaDxfRead : public CDxfRead{
+	// an INSERT of a block, kept when it is in another block, or comes before its block
+	struct Insert
+	{
+		std::string name;
+		Point point;
+		double scale_x, scale_y, rotation;
+	};
+
+	// a block's curves, read once, then copied into m_area, moved into place, for each INSERT of it
+	struct Block
+	{
+		Point base;
+		std::list<CCurve> curves;
+		std::vector<Insert> inserts;
+	};
+
+	size_t m_first_curve; // the first of m_area's curves that this reads
+	std::list<CCurve>* m_curves; // where the lines and arcs go; m_area's curves, or those of the block being read
+	std::map<std::string, Block> m_blocks;
+	Block* m_block; // the block being read
+	std::vector<Insert> m_later_inserts; // INSERTs of blocks not yet read
+
 	void StartCurveIfNecessary(const double* s);
+	static void JoinCurves(std::list<CCurve>& curves, size_t first);
+	void AddInsert(const Insert& insert, const CInsertTransform* outer, int depth)const;
 
 public:
 	CArea* m_area;
+	bool m_join_curves; // at the end, join the curves' ends, whatever order the lines and arcs came in
+	bool m_spline_arcs; // splines are fitted with arcs within m_area's accuracy, rather than with lines
+	bool m_expand_inserts; // each INSERT adds its block's curves; blocks' own curves aren't added where they were drawn
 	AreaDxfRead(CArea* area, const char* filepath);
 
+	size_t NumOpenCurves()const; // of the curves read, those whose ends didn't meet
+
 	// AreaDxfRead's virtual functions
 	void OnReadLine(const double* s, const double* e) override;
 	void OnReadArc(const double* s, const double* e, const double* c, bool dir) override;
+	void OnReadCircle(const double* s, const double* c, bool dir) override;
+	void OnReadSpline(struct SplineData& sd) override;
+	void OnReadInsert(const double* point, const double* scale, const char* name, double rotation) override;
+	void OnReadBlock(const char* name, const double* base) override;
+	void OnReadEndBlock() override;
+	void AddGraphics() const override;
+};
+
+// writes CArea curves, or toolpaths, as DXF entities
+class AreaDxfWrite : public CDxfWrite{
+	std::vector<double> m_xy; // of the curve being written as a LWPOLYLINE, kept to save allocating for each curve
+	std::vector<double> m_bulges;
+
+public:
+	bool m_polylines; // curves as LWPOLYLINEs, with their arcs as bulges, rather than as LINEs and ARCs
+	AreaDxfWrite(const char* filepath, bool binary = false);
+
+	void WriteCurve(const CCurve& curve, const char* layer_name = "0");
+	void WriteCurves(const std::list<CCurve>& curves, const char* layer_name = "0"); // a toolpath, for example
+	void WriteArea(const CArea& area, const char* layer_name = "0");
 };
@@ -10,6 +10,15 @@
 #include <memory>
 #include <set>
 
+static CAreaProcessingContext LinesOnly(const CAreaProcessingContext *ctx)
+{
+	// the caller's settings for booleans and offsets, but leaving their results as lines
+	CAreaProcessingContext lines_ctx;
+	if(ctx)lines_ctx = *ctx;
+	lines_ctx.fit_arcs = false;
+	return lines_ctx;
+}
+
 class IslandAndOffset
 {
 public:
@@ -18,14 +27,16 @@ public:
 	std::list<CCurve> island_inners;
 	std::list<IslandAndOffset*> touching_offsets;
 
-    IslandAndOffset(const CCurve* Island, const CAreaPocketParams &params, double accuracy) : offset(accuracy)
+    IslandAndOffset(const CCurve* Island, const CAreaPocketParams &params, double accuracy, const CAreaProcessingContext *ctx) : offset(accuracy)
 	{
 		island = Island;
 
+		// the offset is only tested against and subtracted, so it stays as lines; its inner curves get offset again
 		offset.m_curves.push_back(*island);
 		offset.m_curves.back().Reverse();
 
-		offset.Offset(-params.stepover);
+		CAreaProcessingContext lines_ctx = LinesOnly(ctx);
+		offset.Offset(-params.stepover, &lines_ctx);
 
 
 		if(offset.m_curves.size() > 1)
@@ -36,6 +47,7 @@ public:
 				if(first) { first = false; continue; }
 				island_inners.push_back(c);
 				island_inners.back().Reverse();
+				if(ctx == nullptr || ctx->fit_arcs)island_inners.back().FitArcs(accuracy);
 			}
 			offset.m_curves.resize(1);
 		}
@@ -62,24 +74,60 @@ class GetCurveItem
 {
 public:
 	CurveTree* curve_tree;
-	std::list<CVertex>::iterator EndIt;
+	std::vector<CVertex> m_vertices; // this curve tree's part of the output
+	std::vector<std::pair<size_t, const GetCurveItem*>> m_inners; // each inner's part goes in before m_vertices[first]
 
-	GetCurveItem(CurveTree* ct, std::list<CVertex>::iterator EIt):curve_tree(ct), EndIt(EIt){}
+	GetCurveItem(CurveTree* ct):curve_tree(ct){}
 
-    void GetCurve(CCurve& output, double accuracy, std::list<GetCurveItem> &to_do_list, CAreaProcessingContext *ctx);
-	CVertex& back(){std::list<CVertex>::iterator It = EndIt; It--; return *It;}
+    void GetCurve(double accuracy, std::list<GetCurveItem> &to_do_list, CAreaProcessingContext *ctx);
+	void AddInner(CurveTree* inner, std::list<GetCurveItem> &to_do_list);
+	CVertex& back(){return m_vertices.back();}
+	void Collect(CCurve& output)const;
 };
 
-// NOTE: GetCurveItem::GetCurve uses iterators for insertion positions, so we keep
-// iterator-based loops here rather than converting to range-for.
-void GetCurveItem::GetCurve(CCurve& output, double accuracy, std::list<GetCurveItem> &to_do_list, CAreaProcessingContext *ctx)
+void GetCurveItem::AddInner(CurveTree* inner, std::list<GetCurveItem> &to_do_list)
+{
+	// the inner's curve goes in just before a vertex at its point_on_parent
+	to_do_list.push_back(GetCurveItem(inner));
+	m_inners.push_back(std::make_pair(m_vertices.size(), &to_do_list.back()));
+	m_vertices.push_back(CVertex(inner->point_on_parent));
+}
+
+void GetCurveItem::Collect(CCurve& output)const
 {
-	// walk around the curve adding spans to output until we get to an inner's point_on_parent
+	// joins the parts together, putting each inner's part before its vertex, depth first without recursion
+	struct Position{const GetCurveItem* item; size_t vertex; size_t inner;};
+	std::vector<Position> stack;
+	stack.push_back(Position{this, 0, 0});
+	while(stack.size() > 0)
+	{
+		Position &pos = stack.back();
+		const GetCurveItem &item = *pos.item;
+		if(pos.inner < item.m_inners.size() && item.m_inners[pos.inner].first == pos.vertex)
+		{
+			const GetCurveItem *inner = item.m_inners[pos.inner++].second;
+			stack.push_back(Position{inner, 0, 0});
+		}
+		else if(pos.vertex < item.m_vertices.size())
+		{
+			output.m_vertices.push_back(item.m_vertices[pos.vertex++]);
+		}
+		else
+		{
+			stack.pop_back();
+		}
+	}
+}
+
+void GetCurveItem::GetCurve(double accuracy, std::list<GetCurveItem> &to_do_list, CAreaProcessingContext *ctx)
+{
+	// walk around the curve adding spans to this item's vertices until we get to an inner's point_on_parent
 	// then add a line from the inner's point_on_parent to inner's start point, then GetCurve from inner
 
 	// add start point
 	if(ctx && ctx->please_abort)return;
-	output.m_vertices.insert(this->EndIt, CVertex(curve_tree->curve.m_vertices.front()));
+	m_vertices.reserve(curve_tree->curve.m_vertices.size() + 2 * curve_tree->inners.size());
+	m_vertices.push_back(CVertex(curve_tree->curve.m_vertices.front()));
 
 	std::list<CurveTree*> inners_to_visit;
 	for(auto &inner : curve_tree->inners)
@@ -89,9 +137,8 @@ void GetCurveItem::GetCurve(CCurve& output, double accuracy, std::list<GetCurveI
 
 	const CVertex* prev_vertex = nullptr;
 
-	for(std::list<CVertex>::iterator It = curve_tree->curve.m_vertices.begin(); It != curve_tree->curve.m_vertices.end(); It++)
+	for(const auto &vertex : curve_tree->curve.m_vertices)
 	{
-		const CVertex& vertex = *It;
 		if(prev_vertex)
 		{
 			Span span(prev_vertex->m_p, vertex);
@@ -120,18 +167,15 @@ void GetCurveItem::GetCurve(CCurve& output, double accuracy, std::list<GetCurveI
 				CurveTree& inner = *(pair.second);
 				if(inner.point_on_parent.dist(back().m_p) > 0.01)
 				{
-					output.m_vertices.insert(this->EndIt, CVertex(vertex.m_type, inner.point_on_parent, vertex.m_c));
+					m_vertices.push_back(CVertex(vertex.m_type, inner.point_on_parent, vertex.m_c));
 				}
 				if(ctx && ctx->please_abort)return;
 
 				// vertex add after GetCurve
-				std::list<CVertex>::iterator VIt = output.m_vertices.insert(this->EndIt, CVertex(inner.point_on_parent));
-
-				//inner.GetCurve(output);
-				to_do_list.push_back(GetCurveItem(&inner, VIt));
+				AddInner(&inner, to_do_list);
 			}
 
-			if(back().m_p != vertex.m_p)output.m_vertices.insert(this->EndIt, vertex);
+			if(back().m_p != vertex.m_p)m_vertices.push_back(vertex);
 		}
 		prev_vertex = &vertex;
 	}
@@ -142,16 +186,12 @@ void GetCurveItem::GetCurve(CCurve& output, double accuracy, std::list<GetCurveI
 		CurveTree &inner = *(*It2);
 		if(inner.point_on_parent != back().m_p)
 		{
-			output.m_vertices.insert(this->EndIt, CVertex(inner.point_on_parent));
+			m_vertices.push_back(CVertex(inner.point_on_parent));
 		}
 		if(ctx && ctx->please_abort)return;
 
 		// vertex add after GetCurve
-		std::list<CVertex>::iterator VIt = output.m_vertices.insert(this->EndIt, CVertex(inner.point_on_parent));
-
-		//inner.GetCurve(output);
-		to_do_list.push_back(GetCurveItem(&inner, VIt));
-
+		AddInner(&inner, to_do_list);
 	}
 }
 
@@ -189,9 +229,11 @@ void CurveTree::MakeOffsets2(double accuracy, std::list<CurveTree*> &to_do_list,
 	// make offsets
 
 	if(ctx && ctx->please_abort)return;
+	// the offset has islands subtracted from it before it's used, so it's only fitted with arcs once, after that
 	CArea smaller(accuracy);
+	CAreaProcessingContext lines_ctx = LinesOnly(ctx);
 	smaller.m_curves.push_back(curve);
-	smaller.Offset(m_params.stepover);
+	smaller.Offset(m_params.stepover, &lines_ctx);
 
 	if(ctx && ctx->please_abort)return;
 
@@ -226,7 +268,7 @@ void CurveTree::MakeOffsets2(double accuracy, std::list<CurveTree*> &to_do_list,
 				if(ctx && ctx->please_abort)return;
 			}
 
-			smaller.Subtract(island_and_offset->offset);
+			smaller.Subtract(island_and_offset->offset, &lines_ctx);
 
 			std::set<const IslandAndOffset*> added;
 
@@ -246,7 +288,7 @@ void CurveTree::MakeOffsets2(double accuracy, std::list<CurveTree*> &to_do_list,
 				touching.add_to->inners.back()->point_on_parent = touching.add_to->curve.NearestPoint(*touching.island_and_offset->island, accuracy);
 				Point island_point = touching.island_and_offset->island->NearestPoint(touching.add_to->inners.back()->point_on_parent, accuracy);
 				touching.add_to->inners.back()->curve.ChangeStart(island_point);
-				smaller.Subtract(touching.island_and_offset->offset);
+				smaller.Subtract(touching.island_and_offset->offset, &lines_ctx);
 
 				// add the island offset's inner curves
 				for(const auto &island_inner : touching.island_and_offset->island_inners)
@@ -290,8 +332,13 @@ void CurveTree::MakeOffsets2(double accuracy, std::list<CurveTree*> &to_do_list,
 		if(ctx->processing_done > ctx->after_MakeOffsets_length)ctx->processing_done = ctx->after_MakeOffsets_length;
 	}
 
+	if(ctx == nullptr || ctx->fit_arcs)smaller.FitArcs();
+
+	// smaller is in order from Offset, and fitting arcs doesn't change that
 	std::list<CArea> separate_areas;
-	smaller.Split(separate_areas);
+	CAreaProcessingContext split_ctx;
+	split_ctx.trust_ordered = true;
+	smaller.Split(separate_areas, &split_ctx);
 	if(ctx && ctx->please_abort)return;
 	for(auto &separate_area : separate_areas)
 	{
@@ -365,8 +412,10 @@ void recur(std::list<CArea> &arealist, const CArea& a1, const CAreaPocketParams
 	}
     else
 	{
-        // split curves into new areas
-		a_offset.Reorder();
+        // split curves into new areas, a_offset is already in order from Offset
+		CAreaProcessingContext reorder_ctx;
+		reorder_ctx.trust_ordered = true;
+		a_offset.Reorder(&reorder_ctx);
         CArea* a2 = nullptr;
 
 		for(auto &curve : a_offset.m_curves)
@@ -467,7 +516,7 @@ void CArea::MakeOnePocketCurve(std::list<CCurve> &curve_list, const CAreaPocketP
 	for(const auto &c : m_curves)
 	{
 		if(first) { first = false; continue; }
-                    IslandAndOffset island_and_offset(&c, params, m_accuracy);
+                    IslandAndOffset island_and_offset(&c, params, m_accuracy, ctx);
 		offset_islands.push_back(island_and_offset);
 		top_level.offset_islands.push_back(&(offset_islands.back()));
 		if(ctx && ctx->please_abort)return;
@@ -492,16 +541,20 @@ void CArea::MakeOnePocketCurve(std::list<CCurve> &curve_list, const CAreaPocketP
 	curve_list.push_back(CCurve());
 	CCurve& output = curve_list.back();
 
+	// each curve tree makes its own part of the output, which are joined together at the end
 	std::list<GetCurveItem> get_curve_to_do_list;
-	get_curve_to_do_list.push_back(GetCurveItem(&top_level, output.m_vertices.end()));
+	get_curve_to_do_list.push_back(GetCurveItem(&top_level));
 
-	while(get_curve_to_do_list.size() > 0)
+	for(std::list<GetCurveItem>::iterator It = get_curve_to_do_list.begin(); It != get_curve_to_do_list.end(); It++)
 	{
-		GetCurveItem item = get_curve_to_do_list.front();
-		item.GetCurve(output, m_accuracy, get_curve_to_do_list, ctx);
-		get_curve_to_do_list.pop_front();
+		It->GetCurve(m_accuracy, get_curve_to_do_list, ctx);
 	}
 
+	size_t num_vertices = 0;
+	for(const auto &item : get_curve_to_do_list)num_vertices += item.m_vertices.size();
+	output.m_vertices.reserve(num_vertices);
+	get_curve_to_do_list.front().Collect(output);
+
 	// unique_ptr handles cleanup when top_level goes out of scope
 
 	if(ctx) ctx->processing_done += ctx->single_area_processing_length * 0.1;
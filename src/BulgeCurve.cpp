@@ -0,0 +1,140 @@
+// BulgeCurve.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "BulgeCurve.h"
+
+#include <algorithm>
+
+double CBulgeCurve::Bulge(const Span& span)
+{
+	if(span.m_v.m_type == 0)return 0.0;
+	return tan(span.IncludedAngle() * 0.25);
+}
+
+Point CBulgeCurve::Centre(const Point& s, const Point& e, double bulge)
+{
+	// the centre is on the perpendicular bisector of the chord, (1 - b²) / 4b of the chord's length to the left
+	Point v = e - s;
+	double f = (1.0 - bulge * bulge) / (4.0 * bulge);
+	return (s + e) * 0.5 + Point(-v.y, v.x) * f;
+}
+
+void CBulgeCurve::FromCurve(const CCurve& curve)
+{
+	m_vertices.clear();
+	m_user_data.clear();
+	m_vertices.reserve(curve.m_vertices.size());
+
+	const Point *prev_p = nullptr;
+	bool user_data = false;
+	for(const auto &vertex : curve.m_vertices)
+	{
+		m_vertices.push_back(CBulgeVertex(vertex.m_p, prev_p ? Bulge(Span(*prev_p, vertex)) : 0.0));
+		if(vertex.m_user_data)user_data = true;
+		prev_p = &(vertex.m_p);
+	}
+
+	if(user_data)
+	{
+		m_user_data.reserve(curve.m_vertices.size());
+		for(const auto &vertex : curve.m_vertices)m_user_data.push_back(vertex.m_user_data);
+	}
+}
+
+void CBulgeCurve::ToCurve(CCurve& curve)const
+{
+	curve.m_vertices.clear();
+	curve.m_vertices.reserve(m_vertices.size());
+
+	for(size_t i = 0; i < m_vertices.size(); i++)
+	{
+		const CBulgeVertex &v = m_vertices[i];
+		int user_data = m_user_data.empty() ? 0 : m_user_data[i];
+		if(i > 0 && v.m_bulge != 0.0)
+		{
+			const Point &prev_p = m_vertices[i - 1].m_p;
+			CVertex::Type type = (v.m_bulge > 0) ? CVertex::vt_ccw_arc : CVertex::vt_cw_arc;
+			curve.m_vertices.push_back(CVertex(type, v.m_p, Centre(prev_p, v.m_p, v.m_bulge), user_data));
+		}
+		else
+		{
+			curve.m_vertices.push_back(CVertex(v.m_p, user_data));
+		}
+	}
+}
+
+double CBulgeCurve::GetArea()const
+{
+	// each span adds its chord's part, as Span::GetArea does for a line,
+	// arcs then take off the area between chord and arc, r²(a - sin a)/2 for included angle a
+	double area = 0.0;
+	for(size_t i = 1; i < m_vertices.size(); i++)
+	{
+		const Point &s = m_vertices[i - 1].m_p;
+		const Point &e = m_vertices[i].m_p;
+		double b = m_vertices[i].m_bulge;
+		area += 0.5 * (e.x - s.x) * (s.y + e.y);
+		if(b != 0.0)
+		{
+			Point v = e - s;
+			double r = (v * v) * (1.0 + b * b) * (1.0 + b * b) / (16.0 * b * b); // radius squared
+			double a = 4.0 * atan(b);
+			double a_minus_sin_a;
+			if(fabs(a) < 1.0e-2)a_minus_sin_a = a * a * a / 6.0 * (1.0 - a * a / 20.0 * (1.0 - a * a / 42.0)); // avoid cancellation
+			else a_minus_sin_a = a - sin(a);
+			area -= 0.5 * r * a_minus_sin_a;
+		}
+	}
+	return area;
+}
+
+double CBulgeCurve::Perim()const
+{
+	double perim = 0.0;
+	for(size_t i = 1; i < m_vertices.size(); i++)
+	{
+		double chord = m_vertices[i].m_p.dist(m_vertices[i - 1].m_p);
+		double b = fabs(m_vertices[i].m_bulge);
+		if(b == 0.0)perim += chord;
+		else perim += chord * atan(b) * (1.0 + b * b) / b; // included angle times radius
+	}
+	return perim;
+}
+
+void CBulgeCurve::Tessellate(double accuracy, std::vector<Point> &pts)const
+{
+	// as CCurve::UnFitArcs, but stepping round each arc by rotating, rather than with a sin and cos for every point
+	if(m_vertices.size() == 0)return;
+	pts.push_back(m_vertices.front().m_p);
+
+	for(size_t i = 1; i < m_vertices.size(); i++)
+	{
+		const Point &s = m_vertices[i - 1].m_p;
+		const CBulgeVertex &v = m_vertices[i];
+		if(v.m_bulge != 0.0 && s != v.m_p)
+		{
+			Point c = Centre(s, v.m_p, v.m_bulge);
+			Point radial = s - c;
+			double radius = radial.length();
+			double a = 4.0 * atan(v.m_bulge);
+			double dphi = 2 * acos(std::max(-1.0, (radius - accuracy) / radius));
+			int segments = (dphi > 0.0) ? static_cast<int>(ceil(fabs(a) / dphi)) : 1;
+			segments = std::max(1, std::min(5000, segments));
+
+			double step = a / segments;
+			double cos_step = cos(step);
+			double sin_step = sin(step);
+			for(int k = 1; k < segments; k++)
+			{
+				radial = Point(radial.x * cos_step - radial.y * sin_step, radial.x * sin_step + radial.y * cos_step);
+				pts.push_back(c + radial);
+			}
+		}
+		pts.push_back(v.m_p);
+	}
+}
+
+size_t CBulgeCurve::MemoryUsed()const
+{
+	return m_vertices.capacity() * sizeof(CBulgeVertex) + m_user_data.capacity() * sizeof(int);
+}
@@ -0,0 +1,44 @@
+// BulgeCurve.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+#include "Curve.h"
+#include <vector>
+
+// a vertex of a CBulgeCurve; the end point of a span and the bulge of that span.
+// bulge is tan(included angle / 4), positive for anti-clockwise arcs, negative for clockwise arcs, 0 for lines,
+// as in a DXF LWPOLYLINE, except that here it belongs to the span ending at this vertex, like CVertex::m_type does.
+struct CBulgeVertex
+{
+	Point m_p;
+	double m_bulge;
+
+	CBulgeVertex():m_p(0, 0), m_bulge(0.0){}
+	CBulgeVertex(const Point& p, double bulge = 0.0):m_p(p), m_bulge(bulge){}
+};
+
+// a compact form of CCurve, for holding very long toolpaths.
+// a CVertex is 48 bytes; a CBulgeVertex is 24, because arc centres are worked out from the bulge when needed
+class CBulgeCurve
+{
+public:
+	std::vector<CBulgeVertex> m_vertices;
+	std::vector<int> m_user_data; // empty, unless a vertex had user data, then one for each vertex
+
+	CBulgeCurve(){}
+	CBulgeCurve(const CCurve& curve){FromCurve(curve);}
+
+	void FromCurve(const CCurve& curve);
+	void ToCurve(CCurve& curve)const;
+	void append(const Point& p, double bulge = 0.0){m_vertices.push_back(CBulgeVertex(p, bulge));}
+
+	double GetArea()const; // same sign convention as CCurve::GetArea
+	bool IsClockwise()const{return GetArea()>0;}
+	double Perim()const;
+	void Tessellate(double accuracy, std::vector<Point> &pts)const; // lines through points within accuracy of the curve
+	size_t MemoryUsed()const; // bytes of vertex storage, including unused capacity
+
+	static double Bulge(const Span& span);
+	static Point Centre(const Point& s, const Point& e, double bulge);
+};
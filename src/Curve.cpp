@@ -7,6 +7,7 @@
 #include "Arc.h"
 #include "Area.h"
 #include "kurve/geometry.h"
+#include <algorithm>
 #include <memory>
 
 const Point operator*(const double &d, const Point &p){ return p * d;}
@@ -49,6 +50,10 @@ CVertex::CVertex(const Point& p, int user_data):m_type(CVertex::vt_line), m_p(p)
 {
 }
 
+#ifdef AREA_COUNTERS
+CCurveCounters CCurve::counters;
+#endif
+
 void CCurve::append(const CVertex& vertex)
 {
 	m_vertices.push_back(vertex);
@@ -65,7 +70,119 @@ public:
 };
 
 
-bool CCurve::CheckForArc(const CVertex& prev_vt, std::list<const CVertex*>& might_be_an_arc, CArcOrLine &arc_or_line_returned, double accuracy)
+class CArcFitBand
+{
+	// what is known about the points in might_be_an_arc, measured from the last circle or line they were all checked against.
+	// a point's distance from a new candidate circle is at most its distance from that circle, plus how far the circle has moved,
+	// so while the candidates stay close, the earlier points still pass and only the newest point needs checking
+public:
+	bool m_valid;
+	bool m_is_a_line;
+	size_t m_num_points; // how many of might_be_an_arc this knows about
+	Point m_start;
+	Point m_c; // the circle's centre, or for a line, its unit direction
+	double m_radius;
+	bool m_dir; // true for an anti-clockwise arc
+	double m_start_angle;
+	double m_max_point_dist; // furthest any point is from the circle or line
+	double m_max_mid_dist; // furthest the middle of any span is from the circle
+	double m_min_centre_dist; // nearest any point is to the centre
+	double m_min_angle, m_max_angle; // the points' angles from the start, in the arc's direction
+	double m_max_reach; // for a line, furthest any point is from the start
+	double m_min_dot; // for a line, least dot product of a span's direction with the line's
+
+	CArcFitBand():m_valid(false){}
+
+	void Set(const CircleOrLine& c, const CArc* arc, const Point& start, const std::vector<const CVertex*>& might_be_an_arc)
+	{
+		m_valid = true;
+		m_is_a_line = c.m_is_a_line;
+		m_num_points = 0;
+		m_start = start;
+		if(m_is_a_line)
+		{
+			m_c = c.m_p1 - c.m_p0;
+			m_c.normalize();
+		}
+		else
+		{
+			m_c = c.m_c;
+			m_radius = c.m_radius;
+			m_dir = arc->m_dir;
+			m_start_angle = atan2(start.y - m_c.y, start.x - m_c.x);
+		}
+		m_max_point_dist = m_is_a_line ? 0.0 : fabs(start.dist(m_c) - m_radius);
+		m_max_mid_dist = 0.0;
+		m_min_centre_dist = m_is_a_line ? 0.0 : start.dist(m_c);
+		m_min_angle = 6.2831853071795864;
+		m_max_angle = 0.0;
+		m_max_reach = 0.0;
+		m_min_dot = 1.0;
+
+		const Point* prev_p = &start;
+		for(auto *vt : might_be_an_arc)
+		{
+			Add(*prev_p, vt->m_p);
+			prev_p = &(vt->m_p);
+		}
+	}
+
+	void Add(const Point& prev_p, const Point& p)
+	{
+		m_num_points++;
+		if(m_is_a_line)
+		{
+			Point v = p - m_start;
+			m_max_point_dist = std::max(m_max_point_dist, fabs(v ^ m_c));
+			m_max_reach = std::max(m_max_reach, v.length());
+			Point dir = p - prev_p;
+			dir.normalize();
+			m_min_dot = std::min(m_min_dot, dir * m_c);
+			return;
+		}
+
+		double centre_dist = p.dist(m_c);
+		m_max_point_dist = std::max(m_max_point_dist, fabs(centre_dist - m_radius));
+		m_max_mid_dist = std::max(m_max_mid_dist, fabs(((prev_p + p) * 0.5).dist(m_c) - m_radius));
+		m_min_centre_dist = std::min(m_min_centre_dist, centre_dist);
+		double angle = atan2(p.y - m_c.y, p.x - m_c.x) - m_start_angle;
+		if(!m_dir)angle = -angle;
+		if(angle < 0.0)angle += 6.2831853071795864;
+		m_min_angle = std::min(m_min_angle, angle);
+		m_max_angle = std::max(m_max_angle, angle);
+	}
+
+	bool DistancesCover(const CircleOrLine& c, size_t num_points, double accuracy)const
+	{
+		// true if all but the newest point must pass CheckForArc's PointIsOn and LineIsOn tests against c
+		const double safety = 1.0 - 1.0e-9;
+		if(!m_valid || num_points != m_num_points + 1 || c.m_is_a_line != m_is_a_line)return false;
+		if(m_is_a_line)
+		{
+			if(c.m_p0 != m_start || c.m_p1 == c.m_p0)return false;
+			Point dir = c.m_p1 - c.m_p0;
+			dir.normalize();
+			double moved = (dir - m_c).length();
+			return m_max_point_dist + m_max_reach * moved < accuracy * 0.1 * safety && m_min_dot - moved > -0.0000000001 * safety;
+		}
+		double moved = c.m_c.dist(m_c) + fabs(c.m_radius - m_radius);
+		return m_max_point_dist + moved < accuracy * 0.1 * safety && m_max_mid_dist + moved < accuracy * 2.0 * safety;
+	}
+
+	bool AnglesCover(const CArc& arc, double included_angle)const
+	{
+		// true if all but the newest point must be between the start and end of arc.
+		// moving the centre by d turns the direction to a point at least r from it by at most d / (r - d)
+		if(arc.m_dir != m_dir)return false;
+		double moved = arc.m_c.dist(m_c);
+		if(moved > 0.5 * m_min_centre_dist)return false;
+		double turned = 2 * moved / (m_min_centre_dist - moved); // for the point and for the start
+		const double margin = 1.0e-12;
+		return m_min_angle - turned > margin && m_max_angle + turned < included_angle - margin;
+	}
+};
+
+bool CCurve::CheckForArc(const CVertex& prev_vt, std::vector<const CVertex*>& might_be_an_arc, CArcFitBand &band, CArcOrLine &arc_or_line_returned, double accuracy)
 {
 	// this examines the vertices in might_be_an_arc
 	// if they do fit an arc, set arc to be the arc that they fit and return true
@@ -73,19 +190,8 @@ bool CCurve::CheckForArc(const CVertex& prev_vt, std::list<const CVertex*>& migh
 	if(might_be_an_arc.size() < 2)return false;
 
 	// find middle point
-	unsigned int num = static_cast<unsigned int>(might_be_an_arc.size());
-	int i = 0;
-	const CVertex* mid_vt = nullptr;
-	int mid_i = (num-1)/2;
-	for(auto *vt : might_be_an_arc)
-	{
-		if(i == mid_i)
-		{
-			mid_vt = vt;
-			break;
-		}
-		i++;
-	}
+	size_t num = might_be_an_arc.size();
+	const CVertex* mid_vt = might_be_an_arc[(num-1)/2];
 
 	// create a circle to test
 	Point p0(prev_vt.m_p);
@@ -93,9 +199,12 @@ bool CCurve::CheckForArc(const CVertex& prev_vt, std::list<const CVertex*>& migh
 	Point p2(might_be_an_arc.back()->m_p);
 	CircleOrLine c(p0, p1, p2);
 
-	const CVertex* current_vt = &prev_vt;
-	for(auto *vt : might_be_an_arc)
+	// the points before the newest one might already be known to fit
+	bool distances_known = band.DistancesCover(c, num, accuracy);
+	const CVertex* current_vt = distances_known ? might_be_an_arc[num - 2] : &prev_vt;
+	for(size_t i = distances_known ? (num - 1) : 0; i < num; i++)
 	{
+		const CVertex* vt = might_be_an_arc[i];
 		if(!c.PointIsOn(vt->m_p, accuracy * 0.1))
 			return false;
 		if(!c.LineIsOn(current_vt->m_p, vt->m_p, accuracy * 2.0))
@@ -109,6 +218,8 @@ bool CCurve::CheckForArc(const CVertex& prev_vt, std::list<const CVertex*>& migh
 	if (c.m_is_a_line)
 	{
 		arc_or_line_returned = CArcOrLine(arc, true);
+		if(distances_known)band.Add(might_be_an_arc[num - 2]->m_p, p2);
+		else band.Set(c, nullptr, p0, might_be_an_arc);
 		return true;
 	}
 	arc.m_c = c.m_c;
@@ -130,8 +241,10 @@ bool CCurve::CheckForArc(const CVertex& prev_vt, std::list<const CVertex*>& migh
 
 	if(arc.IncludedAngle() >= 3.15)return false; // We don't want full arcs, so limit to about 180 degrees
 
-	for(auto *vt : might_be_an_arc)
+	bool angles_known = distances_known && band.AnglesCover(arc, fabs(ange - angs));
+	for(size_t i = angles_known ? (num - 1) : 0; i < num; i++)
 	{
+		const CVertex* vt = might_be_an_arc[i];
 		double angp = atan2(vt->m_p.y - arc.m_c.y, vt->m_p.x - arc.m_c.x);
 		if(arc.m_dir)
 		{
@@ -148,14 +261,16 @@ bool CCurve::CheckForArc(const CVertex& prev_vt, std::list<const CVertex*>& migh
 	}
 
 	arc_or_line_returned = CArcOrLine(arc, false);
+	if(angles_known)band.Add(might_be_an_arc[num - 2]->m_p, p2);
+	else band.Set(c, &arc, p0, might_be_an_arc);
 	return true;
 }
 
-bool CheckAddedRadii(const std::list<CVertex> &new_vertices)
+bool CheckAddedRadii(const std::vector<CVertex> &new_vertices)
 {
 	if (new_vertices.size() > 1)
 	{
-		std::list<CVertex>::const_iterator It = new_vertices.end();
+		std::vector<CVertex>::const_iterator It = new_vertices.end();
 		It--;
 		const CVertex& v = *It;
 		if (v.m_type != 0)
@@ -175,14 +290,15 @@ bool CheckAddedRadii(const std::list<CVertex> &new_vertices)
 }
 
 
-void CCurve::AddArcOrLines(bool check_for_arc, std::list<CVertex> &new_vertices, std::list<const CVertex*>& might_be_an_arc, CArcOrLine &arc_or_line, bool &arc_found, bool &arc_added, double accuracy)
+void CCurve::AddArcOrLines(bool check_for_arc, std::vector<CVertex> &new_vertices, std::vector<const CVertex*>& might_be_an_arc, CArcFitBand &band, CArcOrLine &arc_or_line, bool &arc_found, bool &arc_added, double accuracy)
 {
-    if (check_for_arc && CheckForArc(new_vertices.back(), might_be_an_arc, arc_or_line, accuracy))
+    if (check_for_arc && CheckForArc(new_vertices.back(), might_be_an_arc, band, arc_or_line, accuracy))
 	{
 		arc_found = true;
 	}
 	else
 	{
+		band.m_valid = false; // might_be_an_arc or its start is about to change
 		if (arc_found)
 		{
 			if (arc_or_line.m_is_a_line || arc_or_line.m_arc.AlmostALine(accuracy))
@@ -228,9 +344,11 @@ void CCurve::AddArcOrLines(bool check_for_arc, std::list<CVertex> &new_vertices,
 
 void CCurve::FitArcs(double accuracy)
 {
-	std::list<CVertex> new_vertices;
+	std::vector<CVertex> new_vertices;
+	new_vertices.reserve(m_vertices.size());
 
-	std::list<const CVertex*> might_be_an_arc;
+	std::vector<const CVertex*> might_be_an_arc;
+	CArcFitBand band;
 	CArcOrLine arc_or_line(CArc(), false);
 	bool arc_found = false;
 	bool arc_added = false;
@@ -243,7 +361,7 @@ void CCurve::FitArcs(double accuracy)
 		{
 			if (i != 0)
 			{
-                            AddArcOrLines(false, new_vertices, might_be_an_arc, arc_or_line, arc_found, arc_added, accuracy);
+                            AddArcOrLines(false, new_vertices, might_be_an_arc, band, arc_or_line, arc_found, arc_added, accuracy);
 			}
 			new_vertices.push_back(vt);
 		}
@@ -258,7 +376,7 @@ void CCurve::FitArcs(double accuracy)
 				}
 				else
 				{
-                                    AddArcOrLines(true, new_vertices, might_be_an_arc, arc_or_line, arc_found, arc_added, accuracy);
+                                    AddArcOrLines(true, new_vertices, might_be_an_arc, band, arc_or_line, arc_found, arc_added, accuracy);
 				}
 			}
 		}
@@ -266,13 +384,13 @@ void CCurve::FitArcs(double accuracy)
 		i++;
 	}
 
-	if (might_be_an_arc.size() > 0)AddArcOrLines(false, new_vertices, might_be_an_arc, arc_or_line, arc_found, arc_added, accuracy);
+	if (might_be_an_arc.size() > 0)AddArcOrLines(false, new_vertices, might_be_an_arc, band, arc_or_line, arc_found, arc_added, accuracy);
 
 	if (arc_added)
 	{
-		m_vertices.clear();
-		for (auto &v : new_vertices)m_vertices.push_back(v);
-		for (auto *v : might_be_an_arc)m_vertices.push_back(*v);
+		// might_be_an_arc points into m_vertices, so copy those before replacing them
+		for (auto *v : might_be_an_arc)new_vertices.push_back(*v);
+		m_vertices.swap(new_vertices);
 	}
 }
 void CCurve::UnFitArcs(double accuracy)
@@ -360,6 +478,7 @@ void CCurve::UnFitArcs(double accuracy)
 	}
 
 	m_vertices.clear();
+	m_vertices.reserve(new_pts.size());
 
 	for(auto &pt : new_pts)
 	{
@@ -368,85 +487,208 @@ void CCurve::UnFitArcs(double accuracy)
 	}
 }
 
-Point CCurve::NearestPoint(const Point& p, double accuracy)const
+// the span routines used for whole curves, for a curve which has arcs, and with the arc code left out, for a polyline.
+// the line versions do exactly the sums Span does for a line
+
+template<bool lines_only> static double SpanArea(const Point& s, const CVertex& v)
+{
+	if(!lines_only && v.m_type)return Span(s, v).GetArea();
+	return 0.5 * (v.m_p.x - s.x) * (s.y + v.m_p.y);
+}
+
+template<bool lines_only> static double SpanLength(const Point& s, const CVertex& v)
+{
+	if(!lines_only && v.m_type)return Span(s, v).Length();
+	return s.dist(v.m_p);
+}
+
+template<bool lines_only> static void SpanBox(const Point& s, const CVertex& v, CBox2D& box)
+{
+	if(!lines_only && v.m_type)
+	{
+		Span(s, v).GetBox(box);
+		return;
+	}
+	box.Insert(s);
+	box.Insert(v.m_p);
+}
+
+template<bool lines_only> static Point SpanNearestPoint(const Point& s, const CVertex& v, const Point& p)
+{
+	if(!lines_only && v.m_type)return Span(s, v).NearestPoint(p);
+
+	// as Span::NearestPoint, for a line
+	Point vs = v.m_p - s;
+	double length = vs.length();
+	vs.normalize();
+	Point np = (vs * ((p - s) * vs)) + s;
+	double t = (vs * (np - s)) / length;
+	if(t >= 0.0 && t <= 1.0)return np;
+	return (p.dist(s) < p.dist(v.m_p)) ? s : v.m_p;
+}
+
+// the curve versions are given lines_only from HasArcs, which stops at the first arc it finds
+
+template<bool lines_only> static double CurveArea(const std::vector<CVertex> &vertices)
+{
+	double area = 0.0;
+	for(size_t i = 1; i < vertices.size(); i++)
+	{
+		area += SpanArea<lines_only>(vertices[i - 1].m_p, vertices[i]);
+	}
+	return area;
+}
+
+template<bool lines_only> static void CurveBox(const std::vector<CVertex> &vertices, CBox2D& box)
+{
+	for(size_t i = 1; i < vertices.size(); i++)
+	{
+		SpanBox<lines_only>(vertices[i - 1].m_p, vertices[i], box);
+	}
+}
+
+template<bool lines_only> static void CurveLengths(const std::vector<CVertex> &vertices, std::vector<double> &lengths)
+{
+	// the perimeter at each vertex
+	double perim = 0.0;
+	if(vertices.size() > 0)lengths.push_back(perim);
+	for(size_t i = 1; i < vertices.size(); i++)
+	{
+		perim += SpanLength<lines_only>(vertices[i - 1].m_p, vertices[i]);
+		lengths.push_back(perim);
+	}
+}
+
+template<bool lines_only> static double CurvePerim(const std::vector<CVertex> &vertices)
+{
+	double perim = 0.0;
+	for(size_t i = 1; i < vertices.size(); i++)
+	{
+		perim += SpanLength<lines_only>(vertices[i - 1].m_p, vertices[i]);
+	}
+	return perim;
+}
+
+template<bool lines_only> static Point CurveNearestPoint(const std::vector<CVertex> &vertices, const Point& p)
 {
 	double best_dist = 0.0;
 	Point best_point = Point(0, 0);
-	bool best_point_valid = false;
-	Point prev_p = Point(0, 0);
-	bool prev_p_valid = false;
-	bool first_span = true;
-	for(const auto &vertex : m_vertices)
+	for(size_t i = 1; i < vertices.size(); i++)
 	{
-		if(prev_p_valid)
+		Point near_point = SpanNearestPoint<lines_only>(vertices[i - 1].m_p, vertices[i], p);
+		double dist = near_point.dist(p);
+		if(i == 1 || dist < best_dist)
 		{
-                    Point near_point = Span(prev_p, vertex, first_span).NearestPoint(p);
-			first_span = false;
-			double dist = near_point.dist(p);
-			if(!best_point_valid || dist < best_dist)
-			{
-				best_dist = dist;
-				best_point = near_point;
-				best_point_valid = true;
-			}
+			best_dist = dist;
+			best_point = near_point;
 		}
-		prev_p = vertex.m_p;
-		prev_p_valid = true;
 	}
 	return best_point;
 }
 
+Point CCurve::NearestPoint(const Point& p, double accuracy)const
+{
+	return HasArcs() ? CurveNearestPoint<false>(m_vertices, p) : CurveNearestPoint<true>(m_vertices, p);
+}
+
+static void GetSpanBoxes(const std::vector<CVertex> &vertices, std::vector<CBox2D> &boxes);
+
+static double BoxGap(const CBox2D& b0, const CBox2D& b1)
+{
+	// how far apart the boxes are, 0 if they touch
+	double dx = std::max(0.0, std::max(b0.MinX() - b1.MaxX(), b1.MinX() - b0.MaxX()));
+	double dy = std::max(0.0, std::max(b0.MinY() - b1.MaxY(), b1.MinY() - b0.MaxY()));
+	return sqrt(dx * dx + dy * dy);
+}
+
+static void GetChunkBoxes(const std::vector<CBox2D> &boxes, size_t chunk_size, std::vector<CBox2D> &chunk_boxes)
+{
+	// chunk_boxes[k] is the box round the spans ending at vertices 1 + k * chunk_size onwards
+	for(size_t i = 1; i < boxes.size(); i += chunk_size)
+	{
+		CBox2D box;
+		for(size_t j = i; j < std::min(i + chunk_size, boxes.size()); j++)box.Insert(boxes[j]);
+		chunk_boxes.push_back(box);
+	}
+}
+
 Point CCurve::NearestPoint(const CCurve& c, double accuracy, double *d)const
 {
+	// neighbouring spans are near each other, so the spans of both curves are taken in chunks, with a box round each chunk.
+	// pairs of spans are only tried if their chunks' boxes, then their own boxes, are no further apart than the best so far.
+	// the spans are still tried in order, so the point found is the same as trying every pair.
+	// Span::NearestPoint can take up to 2 * accuracy off a distance, to favour starts and midpoints, so that much is allowed for
+	const size_t chunk_size = 16;
+	const double gap_tolerance = 2.0 * accuracy + 1.0e-9;
+	std::vector<CBox2D> boxes, c_boxes, chunk_boxes, c_chunk_boxes;
+	GetSpanBoxes(m_vertices, boxes);
+	GetSpanBoxes(c.m_vertices, c_boxes);
+	GetChunkBoxes(boxes, chunk_size, chunk_boxes);
+	GetChunkBoxes(c_boxes, chunk_size, c_chunk_boxes);
+
 	double best_dist = 0.0;
 	Point best_point = Point(0, 0);
 	bool best_point_valid = false;
-	Point prev_p = Point(0, 0);
-	bool prev_p_valid = false;
-	bool first_span = true;
-	for(const auto &vertex : c.m_vertices)
+	std::vector<size_t> near_chunks;
+	for(size_t c_chunk = 0; c_chunk < c_chunk_boxes.size(); c_chunk++)
 	{
-		if(prev_p_valid)
+		near_chunks.clear();
+		for(size_t chunk = 0; chunk < chunk_boxes.size(); chunk++)
 		{
-			double dist;
-			Point near_point = NearestPoint(Span(prev_p, vertex, first_span), accuracy, &dist);
-			first_span = false;
-			if(!best_point_valid || dist < best_dist)
+			if(!best_point_valid || BoxGap(chunk_boxes[chunk], c_chunk_boxes[c_chunk]) <= best_dist + gap_tolerance)near_chunks.push_back(chunk);
+		}
+
+		size_t c_end = std::min(1 + (c_chunk + 1) * chunk_size, c.m_vertices.size());
+		for(size_t j = 1 + c_chunk * chunk_size; j < c_end; j++)
+		{
+			Span span(c.m_vertices[j - 1].m_p, c.m_vertices[j], j == 1);
+			for(size_t chunk : near_chunks)
 			{
-				best_dist = dist;
-				best_point = near_point;
-				best_point_valid = true;
+				if(best_point_valid && BoxGap(chunk_boxes[chunk], c_boxes[j]) > best_dist + gap_tolerance)continue;
+				size_t end = std::min(1 + (chunk + 1) * chunk_size, m_vertices.size());
+				for(size_t i = 1 + chunk * chunk_size; i < end; i++)
+				{
+					if(best_point_valid && BoxGap(boxes[i], c_boxes[j]) > best_dist + gap_tolerance)continue;
+					double dist;
+					Point near_point = Span(m_vertices[i - 1].m_p, m_vertices[i], i == 1).NearestPoint(span, accuracy, &dist);
+					if(!best_point_valid || dist < best_dist)
+					{
+						best_dist = dist;
+						best_point = near_point;
+						best_point_valid = true;
+					}
+				}
 			}
 		}
-		prev_p = vertex.m_p;
-		prev_p_valid = true;
 	}
 	if(d)*d = best_dist;
 	return best_point;
 }
 
-void CCurve::GetBox(CBox2D &box) const
+bool CCurve::HasArcs()const
 {
-	Point prev_p = Point(0, 0);
-	bool prev_p_valid = false;
-	for(const auto &vertex : m_vertices)
+	// the first vertex's type doesn't matter, it has no span
+	for(size_t i = 1; i < m_vertices.size(); i++)
 	{
-		if(prev_p_valid)
-		{
-			Span(prev_p, vertex).GetBox(box);
-		}
-		prev_p = vertex.m_p;
-		prev_p_valid = true;
+		if(m_vertices[i].m_type != 0)return true;
 	}
+	return false;
+}
+
+void CCurve::GetBox(CBox2D &box) const
+{
+	if(HasArcs())CurveBox<false>(m_vertices, box);
+	else CurveBox<true>(m_vertices, box);
 }
 
 void CCurve::Reverse()
 {
-	std::list<CVertex> new_vertices;
+	std::vector<CVertex> new_vertices;
+	new_vertices.reserve(m_vertices.size());
 
 	CVertex* prev_v = nullptr;
 
-	for(std::list<CVertex>::reverse_iterator It = m_vertices.rbegin(); It != m_vertices.rend(); It++)
+	for(std::vector<CVertex>::reverse_iterator It = m_vertices.rbegin(); It != m_vertices.rend(); It++)
 	{
 		CVertex &v = *It;
 		CVertex::Type type = CVertex::vt_line;
@@ -465,24 +707,12 @@ void CCurve::Reverse()
 		prev_v = &v;
 	}
 
-	m_vertices = new_vertices;
+	m_vertices.swap(new_vertices);
 }
 
 double CCurve::GetArea()const
 {
-	double area = 0.0;
-	Point prev_p = Point(0, 0);
-	bool prev_p_valid = false;
-	for(const auto &vertex : m_vertices)
-	{
-		if(prev_p_valid)
-		{
-			area += Span(prev_p, vertex).GetArea();
-		}
-		prev_p = vertex.m_p;
-		prev_p_valid = true;
-	}
-	return area;
+	return HasArcs() ? CurveArea<false>(m_vertices) : CurveArea<true>(m_vertices);
 }
 
 bool CCurve::IsClosed()const
@@ -513,7 +743,7 @@ void CCurve::ChangeStart(const Point &p) {
 		const Point *prev_p = nullptr;
 
 		int span_index = 0;
-		for(std::list<CVertex>::const_iterator VIt = m_vertices.begin(); VIt != m_vertices.end() && !finished; VIt++)
+		for(std::vector<CVertex>::const_iterator VIt = m_vertices.begin(); VIt != m_vertices.end() && !finished; VIt++)
 		{
 			const CVertex& vertex = *VIt;
 
@@ -571,7 +801,7 @@ void CCurve::Break(const Point &p) {
 	// inserts a point, if it lies on the curve
 	const Point *prev_p = nullptr;
 
-	for(std::list<CVertex>::iterator VIt = m_vertices.begin(); VIt != m_vertices.end(); VIt++)
+	for(std::vector<CVertex>::iterator VIt = m_vertices.begin(); VIt != m_vertices.end(); VIt++)
 	{
 		CVertex& vertex = *VIt;
 
@@ -649,7 +879,7 @@ void CCurve::ExtractSeparateCurves(const std::list<Point> &ordered_points, std::
 void CCurve::RemoveTinySpans() {
 	CCurve new_curve;
 
-	std::list<CVertex>::const_iterator VIt = m_vertices.begin();
+	std::vector<CVertex>::const_iterator VIt = m_vertices.begin();
 	new_curve.m_vertices.push_back(*VIt);
 	VIt++;
 
@@ -665,6 +895,81 @@ void CCurve::RemoveTinySpans() {
 	*this = new_curve;
 }
 
+void CCurve::Simplify(double tolerance)
+{
+	// Douglas-Peucker, on each run of lines between vertices which have to stay; the ends and both ends of every arc.
+	// a vertex stays if it is further than tolerance from the line between its run's vertices which stay so far
+	size_t n = m_vertices.size();
+	if(n < 3)return;
+
+	std::vector<char> keep(n, 0);
+	keep.front() = 1;
+	keep.back() = 1;
+	for(size_t i = 1; i < n; i++)
+	{
+		if(m_vertices[i].m_type != 0)
+		{
+			keep[i - 1] = 1;
+			keep[i] = 1;
+		}
+	}
+
+	std::vector<std::pair<size_t, size_t>> runs;
+	size_t first = 0;
+	for(size_t i = 1; i < n; i++)
+	{
+		if(!keep[i])continue;
+		if(i > first + 1)runs.push_back(std::make_pair(first, i));
+		first = i;
+	}
+
+	double tolerance_squared = tolerance * tolerance;
+	while(runs.size() > 0)
+	{
+		size_t a = runs.back().first;
+		size_t b = runs.back().second;
+		runs.pop_back();
+
+		const Point &pa = m_vertices[a].m_p;
+		Point v = m_vertices[b].m_p - pa;
+		double length_squared = v * v;
+		double furthest = -1.0;
+		size_t furthest_i = a;
+		for(size_t i = a + 1; i < b; i++)
+		{
+			// distance squared from the segment
+			Point w = m_vertices[i].m_p - pa;
+			double t = (length_squared > 0.0) ? std::max(0.0, std::min(1.0, (w * v) / length_squared)) : 0.0;
+			Point d = w - v * t;
+			double dist_squared = d * d;
+			if(dist_squared > furthest)
+			{
+				furthest = dist_squared;
+				furthest_i = i;
+			}
+		}
+
+		if(furthest > tolerance_squared)
+		{
+			keep[furthest_i] = 1;
+			if(furthest_i > a + 1)runs.push_back(std::make_pair(a, furthest_i));
+			if(b > furthest_i + 1)runs.push_back(std::make_pair(furthest_i, b));
+		}
+	}
+
+	size_t num_kept = 0;
+	for(size_t i = 0; i < n; i++)num_kept += keep[i];
+	if(num_kept == n)return;
+
+	std::vector<CVertex> new_vertices;
+	new_vertices.reserve(num_kept);
+	for(size_t i = 0; i < n; i++)
+	{
+		if(keep[i])new_vertices.push_back(m_vertices[i]);
+	}
+	m_vertices.swap(new_vertices);
+}
+
 void CCurve::ChangeEnd(const Point &p) {
 	// changes the end position of the Kurve, doesn't keep closed kurves closed
 	CCurve new_curve;
@@ -730,6 +1035,7 @@ Point CCurve::NearestPoint(const Span& p, double accuracy, double *d)const
 static geoff_geometry::Kurve MakeKurve(const CCurve& curve)
 {
 	geoff_geometry::Kurve k;
+	k.Reserve(static_cast<int>(curve.m_vertices.size()));
 	for(const auto &v : curve.m_vertices)
 	{
 		k.Add(geoff_geometry::spVertex(v.m_type, geoff_geometry::Point(v.m_p.x, v.m_p.y), geoff_geometry::Point(v.m_c.x, v.m_c.y)));
@@ -752,19 +1058,283 @@ static CCurve MakeCCurve(const geoff_geometry::Kurve& k)
 	return c;
 }
 
-static geoff_geometry::Span MakeSpan(const Span& span)
+static bool BoxesApart(const CBox2D& b0, const CBox2D& b1);
+
+class COffsetSpan
 {
-	return geoff_geometry::Span(span.m_v.m_type, geoff_geometry::Point(span.m_p.x, span.m_p.y), geoff_geometry::Point(span.m_v.m_p.x, span.m_v.m_p.y), geoff_geometry::Point(span.m_v.m_c.x, span.m_v.m_c.y));
+	// a span with the properties geoff_geometry::Span works out for it, so that OffsetVertices gives what Kurve::OffsetMethod1 did
+public:
+	Point m_p0, m_p1, m_c;
+	int m_dir;
+	Point m_vs, m_ve; // unit tangents at start and end
+	bool m_null; // too short to count
+
+	COffsetSpan():m_p0(0, 0), m_p1(0, 0), m_c(0, 0), m_dir(0), m_vs(0, 0), m_ve(0, 0), m_null(true){}
+
+	bool Set(const Point& p0, int dir, const Point& p1, const Point& c)
+	{
+		// returns false for an arc with different radii at its ends
+		const double tolerance = geoff_geometry::TOLERANCE;
+		m_p0 = p0;
+		m_p1 = p1;
+		m_c = c;
+		m_dir = dir;
+		if(dir)
+		{
+			m_vs = ~(p0 - c);
+			m_ve = ~(p1 - c);
+			if(dir == -1)
+			{
+				m_vs = -m_vs;
+				m_ve = -m_ve;
+			}
+			double radius = m_vs.normalize();
+			double radius_check = m_ve.normalize();
+			if(fabs(radius - radius_check) > tolerance)return false;
+			if(radius > tolerance)
+			{
+				m_null = (p0.dist(p1) <= tolerance);
+				if(m_null)m_dir = 0;
+			}
+			else m_null = true;
+		}
+		else
+		{
+			m_vs = p1 - p0;
+			m_null = (m_vs.normalize() <= tolerance);
+			m_ve = m_vs;
+		}
+		return true;
+	}
+
+	COffsetSpan Offset(double offset)const
+	{
+		// offset to the left
+		COffsetSpan span = *this;
+		if(fabs(offset) > geoff_geometry::TIGHT_TOLERANCE && !m_null)
+		{
+			span.Set(m_p0 + ~m_vs * offset, m_dir, m_p1 + ~m_ve * offset, m_c);
+		}
+		return span;
+	}
+
+	int Intersect(const COffsetSpan& s, Point& p0, Point& p1)const
+	{
+		std::list<Point> pts;
+		Span(m_p0, CVertex(static_cast<CVertex::Type>(m_dir), m_p1, m_c)).Intersect(Span(s.m_p0, CVertex(static_cast<CVertex::Type>(s.m_dir), s.m_p1, s.m_c)), pts);
+		if(pts.size() > 0)p0 = pts.front();
+		if(pts.size() > 1)p1 = pts.back();
+		return static_cast<int>(pts.size());
+	}
+
+	double LengthTo(const Point& p)const
+	{
+		return Span(m_p0, CVertex(static_cast<CVertex::Type>(m_dir), p, m_c)).Length();
+	}
+};
+
+static bool AddOffsetVertex(std::vector<CVertex> &vertices, int dir, const Point& p, const Point& c)
+{
+	// as Kurve::Add, spans shorter than geoff_geometry::TOLERANCE aren't added
+	if(vertices.size() > 0 && vertices.back().m_p.dist(p) < geoff_geometry::TOLERANCE)return false;
+	vertices.push_back(CVertex(static_cast<CVertex::Type>(dir), p, c));
+	return true;
 }
 
-bool CCurve::Offset(double leftwards_value, double accuracy)
+static void GetSpanBoxes(const std::vector<CVertex> &vertices, std::vector<CBox2D> &boxes)
+{
+	// boxes[i] is the box of the span ending at vertex i
+	boxes.resize(vertices.size());
+	for(size_t i = 1; i < vertices.size(); i++)Span(vertices[i - 1].m_p, vertices[i]).GetBox(boxes[i]);
+}
+
+static bool IntersectionInterferes(const Point& p, const std::vector<CVertex> &original, const std::vector<CBox2D> &original_boxes, double offset)
+{
+	// true if p is nearer to the original curve than the offset, so is on a loop that has to go
+	double d = fabs(offset) - geoff_geometry::TOLERANCE;
+	double far_enough = d + geoff_geometry::TOLERANCE;
+	for(size_t i = 1; i < original.size(); i++)
+	{
+		// no nearer than its box
+		const CBox2D &box = original_boxes[i];
+		double dx = std::max(0.0, std::max(box.MinX() - p.x, p.x - box.MaxX()));
+		double dy = std::max(0.0, std::max(box.MinY() - p.y, p.y - box.MaxY()));
+		if(dx > far_enough || dy > far_enough || dx * dx + dy * dy > far_enough * far_enough)continue;
+
+		if(Span(original[i - 1].m_p, original[i]).NearestPoint(p).dist(p) < d)return true;
+	}
+	return false;
+}
+
+static bool EliminateLoops(const std::vector<CVertex> &k, const std::vector<CVertex> &original, double offset, std::vector<CVertex> &ko)
+{
+	// as geoff_geometry's eliminateLoops; each span is cut off where a later span, not interfering with the original curve, crosses it.
+	// the start point mustn't disappear. returns false if a loop can't be got out of.
+	// span boxes are worked out once, so spans far apart are passed over cheaply
+	const int num_spans = static_cast<int>(k.size()) - 1;
+	std::vector<CBox2D> boxes, original_boxes;
+	GetSpanBoxes(k, boxes);
+	GetSpanBoxes(original, original_boxes);
+
+	COffsetSpan sp0, sp1;
+	Point p_int, p_int_other;
+
+	// a bad span fails the offset, as it does for eliminateLoops, even if the box test below would pass it over
+	for(int i = 1; i <= num_spans; i++)
+	{
+		if(!sp1.Set(k[i - 1].m_p, k[i].m_type, k[i].m_p, k[i].m_c))return false;
+	}
+
+	int k_vertex = 0;
+	while(k_vertex <= num_spans)
+	{
+		bool clipped = false;
+
+		Point p0 = k[k_vertex++].m_p;
+		if(k_vertex == 1)ko.push_back(CVertex(p0));
+		if(k_vertex > num_spans)break;
+
+		int k_save_vertex = k_vertex;
+		const int sp0_vertex = k_vertex;
+		const CVertex &v0 = k[k_vertex++];
+		sp0.Set(p0, v0.m_type, v0.m_p, v0.m_c); // checked above
+
+		int k_save_vertex1 = k_vertex;
+		if(k_vertex <= num_spans)
+		{
+			// start with the span after next
+			Point p1_start = k[k_vertex++].m_p;
+			int k_save_vertex2 = k_vertex;
+
+			int forward_count = 0;
+			while(k_vertex <= num_spans)
+			{
+				const CVertex &v1 = k[k_vertex++];
+				int num_int = 0;
+				if(!BoxesApart(boxes[sp0_vertex], boxes[k_vertex - 1]))
+				{
+					sp1.Set(p1_start, v1.m_type, v1.m_p, v1.m_c);
+					num_int = sp0.Intersect(sp1, p_int, p_int_other);
+				}
+				if(num_int && sp0.m_p0.dist(p_int) < geoff_geometry::TOLERANCE)num_int = 0; // not at the start of the span being checked
+				if(num_int)
+				{
+					if(num_int == 2 && sp0.LengthTo(p_int) > sp0.LengthTo(p_int_other))p_int = p_int_other; // the first on sp0
+					k_save_vertex = k_save_vertex1;
+
+					clipped = true;
+					if(!IntersectionInterferes(p_int, original, original_boxes, offset))
+					{
+						sp0.m_p1 = p_int; // cut this span at the intersection
+						clipped = false;
+						break;
+					}
+				}
+				p1_start = v1.m_p;
+				k_save_vertex1 = k_save_vertex2;
+				k_save_vertex2 = k_vertex;
+
+				if((k_vertex > num_spans || forward_count++ > 25) && !clipped)break;
+			}
+		}
+
+		if(clipped)return false;
+
+		AddOffsetVertex(ko, sp0.m_dir, sp0.m_p1, sp0.m_c);
+		k_vertex = k_save_vertex;
+	}
+	return true;
+}
+
+static bool OffsetVertices(const CCurve& curve, double offset, CCurve& result)
+{
+	// offsets to the left, as Kurve::OffsetMethod1 with its simple loop elimination, but without making a Kurve.
+	// returns false where that would have failed, or thrown
+	const std::vector<CVertex> &vertices = curve.m_vertices;
+	const double tolerance = geoff_geometry::TOLERANCE;
+	size_t n = vertices.size();
+	if(fabs(offset) < tolerance || n < 2)
+	{
+		result = curve;
+		return true;
+	}
+
+	int roll_dir = (offset > 0) ? -1 : 1; // arcs added round corners
+	const Point &front = vertices.front().m_p;
+	const Point &back = vertices.back().m_p;
+	bool closed = (fabs(front.x - back.x) <= tolerance && fabs(front.y - back.y) <= tolerance);
+
+	std::vector<CVertex> k;
+	k.reserve(n + n / 2);
+	COffsetSpan span, span_off, prev_span_off;
+	size_t num_spans = n - 1;
+	size_t last_span = num_spans;
+	if(closed)
+	{
+		// start with the last span as the previous span, and finish with the first span again
+		if(!span.Set(vertices[n - 2].m_p, vertices[n - 1].m_type, back, vertices[n - 1].m_c))return false;
+		prev_span_off = span.Offset(offset);
+		last_span++;
+	}
+
+	for(size_t span_number = 1; span_number <= last_span; span_number++)
+	{
+		size_t i = (span_number > num_spans) ? 1 : span_number;
+		if(!span.Set(vertices[i - 1].m_p, vertices[i].m_type, vertices[i].m_p, vertices[i].m_c))return false;
+
+		if(!span.m_null)
+		{
+			int num_int = 0;
+			Point p0, p1;
+			span_off = span.Offset(offset);
+			if(k.size() == 0)k.push_back(CVertex(span_off.m_p0));
+
+			if(span_number > 1)
+			{
+				double d = span_off.m_p0.dist(prev_span_off.m_p1);
+				if(d > tolerance && !span_off.m_null && !prev_span_off.m_null)
+				{
+					// the offset spans don't join, see if they cross
+					double cp = prev_span_off.m_ve ^ span_off.m_vs;
+					bool inters = (offset > 0) ? (cp > 0) : (cp < 0);
+					if(inters)num_int = prev_span_off.Intersect(span_off, p0, p1);
+
+					if(num_int == 1)k.back() = CVertex(static_cast<CVertex::Type>(prev_span_off.m_dir), p0, prev_span_off.m_c); // end the previous span there
+					else AddOffsetVertex(k, roll_dir, span_off.m_p0, span.m_p0); // roll around the corner, any loop is removed later
+				}
+			}
+
+			if(span_number < n)AddOffsetVertex(k, span_off.m_dir, span_off.m_p1, span_off.m_c);
+			else if(num_int == 1)k.front() = CVertex(p0); // closed; move the start to where the last span crosses the first
+		}
+		if(!span_off.m_null)prev_span_off = span_off;
+	}
+
+	result.m_vertices.clear();
+	result.m_vertices.reserve(k.size());
+	if(!EliminateLoops(k, vertices, offset, result.m_vertices))return false;
+
+	if(closed)
+	{
+		// an offset which turned the curve inside out, or made it smaller where it should grow, has failed
+		const Point &result_front = result.m_vertices.front().m_p;
+		const Point &result_back = result.m_vertices.back().m_p;
+		if(fabs(result_front.x - result_back.x) > tolerance || fabs(result_front.y - result_back.y) > tolerance)return false;
+		double a = curve.GetArea();
+		double ao = result.GetArea();
+		if((a < 0) != (ao < 0))return false;
+		bool bigger = (a > 0 && offset > 0) || (a < 0 && offset < 0);
+		if(bigger && fabs(ao) < fabs(a))return false;
+	}
+	return true;
+}
+
+bool CCurve::KurveOffset(double leftwards_value)
 {
 	// use the kurve code donated by Geoff Hawkesford, to offset the curve as an open curve
 	// returns true for success, false for failure
 	bool success = true;
 
-	CCurve save_curve = *this;
-
 	try
 	{
 		geoff_geometry::Kurve k = MakeKurve(*this);
@@ -776,45 +1346,68 @@ bool CCurve::Offset(double leftwards_value, double accuracy)
 	}
 	catch(...)
 	{
+		// bad geometry comes back in ret; this is for anything the kurve code still throws
+		AREA_COUNT(counters.kurve_exceptions);
 		success = false;
 	}
 
-	if(success == false)
+	return success;
+}
+
+bool CCurve::Offset(double leftwards_value, double accuracy)
+{
+	// offsets the curve as an open curve, working on the vertices; if that fails, the kurve code is tried,
+	// then, for a closed curve, CArea::Offset
+	// returns true for success, false for failure
+	CCurve offset_curve;
+	if(OffsetVertices(*this, leftwards_value, offset_curve))
+	{
+		AREA_COUNT(counters.offsets_direct);
+		*this = offset_curve;
+		return true;
+	}
+
+	if(KurveOffset(leftwards_value))
 	{
-		if(this->IsClosed())
+		AREA_COUNT(counters.offsets_by_kurve);
+		return true;
+	}
+
+	bool success = false;
+	if(this->IsClosed())
+	{
+		double inwards_offset = leftwards_value;
+		bool cw = false;
+		if(this->IsClockwise())
 		{
-			double inwards_offset = leftwards_value;
-			bool cw = false;
-			if(this->IsClockwise())
+			inwards_offset = -inwards_offset;
+			cw = true;
+		}
+		CArea a(accuracy);
+		a.append(*this);
+		a.Offset(inwards_offset);
+		if(a.m_curves.size() == 1)
+		{
+			std::unique_ptr<Span> start_span;
+			if(this->m_vertices.size() > 1)
 			{
-				inwards_offset = -inwards_offset;
-				cw = true;
+				std::vector<CVertex>::iterator It = m_vertices.begin();
+				CVertex &v0 = *It;
+				It++;
+				CVertex &v1 = *It;
+				start_span = std::make_unique<Span>(v0.m_p, v1, true);
 			}
-			CArea a(accuracy);
-			a.append(*this);
-			a.Offset(inwards_offset);
-			if(a.m_curves.size() == 1)
+			*this = a.m_curves.front();
+			if(this->IsClockwise() != cw)this->Reverse();
+			if(start_span)
 			{
-				std::unique_ptr<Span> start_span;
-				if(this->m_vertices.size() > 1)
-				{
-					std::list<CVertex>::iterator It = m_vertices.begin();
-					CVertex &v0 = *It;
-					It++;
-					CVertex &v1 = *It;
-					start_span = std::make_unique<Span>(v0.m_p, v1, true);
-				}
-				*this = a.m_curves.front();
-				if(this->IsClockwise() != cw)this->Reverse();
-				if(start_span)
-				{
-					Point forward = start_span->GetVector(0.0);
-					Point left(-forward.y, forward.x);
-					Point offset_start = start_span->m_p + left * leftwards_value;
-					this->ChangeStart(this->NearestPoint(offset_start, accuracy));
-				}
-				success = true;
+				Point forward = start_span->GetVector(0.0);
+				Point left(-forward.y, forward.x);
+				Point offset_start = start_span->m_p + left * leftwards_value;
+				this->ChangeStart(this->NearestPoint(offset_start, accuracy));
 			}
+			AREA_COUNT(counters.offsets_by_area);
+			success = true;
 		}
 	}
 
@@ -896,19 +1489,7 @@ void CCurve::OffsetForward(double forwards_value, double accuracy, bool refit_ar
 
 double CCurve::Perim()const
 {
-	const Point *prev_p = nullptr;
-	double perim = 0.0;
-	for(const auto &vertex : m_vertices)
-	{
-		if(prev_p)
-		{
-			Span span(*prev_p, vertex);
-			perim += span.Length();
-		}
-		prev_p = &(vertex.m_p);
-	}
-
-	return perim;
+	return HasArcs() ? CurvePerim<false>(m_vertices) : CurvePerim<true>(m_vertices);
 }
 
 Point CCurve::PerimToPoint(double perim)const
@@ -936,6 +1517,29 @@ Point CCurve::PerimToPoint(double perim)const
 	return m_vertices.back().m_p;
 }
 
+void CCurve::PerimToPoints(int num_points, std::vector<Point> &pts)const
+{
+	// one walk along the spans, as the wanted perimeter positions only go forwards
+	if(num_points <= 0 || m_vertices.size() == 0)return;
+	pts.reserve(pts.size() + num_points);
+
+	// the perimeter at each vertex, worked out once for all the points
+	std::vector<double> lengths;
+	lengths.reserve(m_vertices.size());
+	if(HasArcs())CurveLengths<false>(m_vertices, lengths);
+	else CurveLengths<true>(m_vertices, lengths);
+
+	double step = (num_points > 1) ? lengths.back() / (num_points - 1) : 0.0;
+	size_t i = 1;
+	for(int k = 0; k < num_points; k++)
+	{
+		double perim = step * k;
+		while(i < lengths.size() && !(perim < lengths[i]))i++;
+		if(i >= m_vertices.size() || (k > 0 && k == num_points - 1))pts.push_back(m_vertices.back().m_p);
+		else pts.push_back(Span(m_vertices[i - 1].m_p, m_vertices[i]).MidPerim(perim - lengths[i - 1]));
+	}
+}
+
 double CCurve::PointToPerim(const Point& p, double accuracy)const
 {
 	double best_dist = 0.0;
@@ -997,24 +1601,45 @@ void CCurve::CurveIntersections(const CCurve& c, std::list<Point> &pts, double a
 
 void CCurve::SpanIntersections(const Span& s, std::list<Point> &pts)const
 {
-	std::list<Span> spans;
-	GetSpans(spans);
-	for(auto &span : spans)
+	std::list<Point> pts2;
+	const Point *prev_p = nullptr;
+	for(const auto &vertex : m_vertices)
 	{
-		std::list<Point> pts2;
-		span.Intersect(s, pts2);
-		for(auto &pt : pts2)
+		if(prev_p)
 		{
-			if(pts.size() == 0)
-			{
-				pts.push_back(pt);
-			}
-			else
+			pts2.clear();
+			Span(*prev_p, vertex).Intersect(s, pts2);
+			for(auto &pt : pts2)
 			{
-				if(pt != pts.back())pts.push_back(pt);
+				if(pts.size() == 0)
+				{
+					pts.push_back(pt);
+				}
+				else
+				{
+					if(pt != pts.back())pts.push_back(pt);
+				}
 			}
 		}
+		prev_p = &(vertex.m_p);
+	}
+}
+
+int CCurve::WindingNumber(const Point& p)const
+{
+	if(m_vertices.size() == 0)return 0;
+
+	int w = 0;
+	const Point *prev_p = nullptr;
+	for(const auto &vertex : m_vertices)
+	{
+		if(prev_p)w += Span(*prev_p, vertex).WindingNumber(p);
+		prev_p = &(vertex.m_p);
 	}
+
+	// close the curve
+	w += Span(m_vertices.back().m_p, CVertex(m_vertices.front().m_p)).WindingNumber(p);
+	return w;
 }
 
 const Point Span::null_point = Point(0, 0);
@@ -1177,6 +1802,7 @@ void Span::GetBox(CBox2D &box) const
 		}
 
 		if(qe<qs)qe = qe + 4;
+		else if(qe == qs && (vs ^ ve) * m_v.m_type < 0)qe = qe + 4; // starts and ends in the same quadrant, going the long way round
 
 		double rad = m_v.m_p.dist(m_v.m_c);
 
@@ -1304,14 +1930,221 @@ Point Span::GetVector(double fraction)const
 	}
 }
 
+// the intersection kernels below work directly on the span's points,
+// but use the same tolerances and return the points in the same order as geoff_geometry::Intof
+
+// the intersection tests find points up to geoff_geometry::TOLERANCE off each span, so boxes are only apart if they are further apart than that, both ways
+static constexpr double ApartGap = 2.0 * geoff_geometry::TOLERANCE;
+
+static bool BoxesApart(const CBox2D& b0, const CBox2D& b1)
+{
+	return b0.MaxX() + ApartGap < b1.MinX() || b0.MaxY() + ApartGap < b1.MinY() || b0.MinX() - ApartGap > b1.MaxX() || b0.MinY() - ApartGap > b1.MaxY();
+}
+
+static int SolveQuadratic(double a, double b, double c, double& x0, double& x1)
+{
+	// solves ax² + bx + c = 0, as geoff_geometry::quadratic, returning the larger root first
+	const double epsilon = 1.0e-06;
+	if(fabs(a) < epsilon)
+	{
+		if(fabs(b) < epsilon)return 0;
+		x0 = -c / b;
+		return 1;
+	}
+	b /= a;
+	c /= a;
+	double s = b * b - 4 * c;
+	if(s < -epsilon)return 0;
+	x0 = -0.5 * b;
+	if(s > epsilon * epsilon)
+	{
+		s = 0.5 * sqrt(s);
+		x1 = x0 - s;
+		x0 += s;
+		return 2;
+	}
+	return 1;
+}
+
+static bool OnArc(const Span& arc, const Point& p)
+{
+	// p must be on the arc's circle
+	double t = arc.Parameter(p);
+	return t >= 0.0 && t <= 1.0;
+}
+
+static int LineLineIntersect(const Point& s0, const Point& e0, const Point& s1, const Point& e1, Point& p)
+{
+	const Point v0 = e0 - s0;
+	const Point v1 = e1 - s1;
+	const Point v2 = s1 - s0;
+	const double cp = v1 ^ v0;
+	if(fabs(cp) < 1.0e-10)return 0; // parallel or degenerate lines
+
+	const double t0 = (v1 ^ v2) / cp;
+	const double t1 = (v0 ^ v2) / cp;
+	const double toler0 = geoff_geometry::TOLERANCE / sqrt(v0 * v0);
+	const double toler1 = geoff_geometry::TOLERANCE / sqrt(v1 * v1);
+	p = v0 * t0 + s0;
+	return (t0 >= -toler0) & (t0 <= 1 + toler0) & (t1 >= -toler1) & (t1 <= 1 + toler1);
+}
+
+static int LineArcIntersect(const Point& s, const Point& e, const Span& arc, Point& p0, Point& p1)
+{
+	const Point v0 = s - arc.m_v.m_c;
+	const Point v1 = e - s;
+	const Point vr = arc.m_p - arc.m_v.m_c;
+	const double a = v1 * v1;
+	double t[2];
+	int num_roots = SolveQuadratic(a, 2 * (v0 * v1), v0 * v0 - vr * vr, t[0], t[1]);
+	if(num_roots == 0)return 0;
+
+	const double toler = geoff_geometry::TOLERANCE / sqrt(a);
+	int num = 0;
+	Point *out[2] = {&p0, &p1};
+	for(int i = 0; i < num_roots; i++)
+	{
+		if(t[i] > -toler && t[i] < 1 + toler)
+		{
+			Point p = v1 * t[i] + s;
+			if(OnArc(arc, p))*out[num++] = p;
+		}
+	}
+	return num;
+}
+
+static int ArcArcIntersect(const Span& arc0, const Span& arc1, Point& p0, Point& p1)
+{
+	// as geoff_geometry::Intof for two circles, then checking the points are on both arcs
+	const double tolerance = geoff_geometry::TOLERANCE;
+	const double r0 = arc0.m_p.dist(arc0.m_v.m_c);
+	const double r1 = arc1.m_p.dist(arc1.m_v.m_c);
+	Point v = arc1.m_v.m_c - arc0.m_v.m_c;
+	double d = v.normalize();
+	if(d < tolerance)return 0; // concentric circles
+	if(d > r0 + r1 + tolerance || d < fabs(r0 - r1) - tolerance)return 0;
+
+	double d0 = 0.5 * (d + (r0 + r1) * (r0 - r1) / d);
+	if(d0 - r0 > tolerance)return 0;
+
+	double h = (r0 - d0) * (r0 + d0);
+	if(h < 0)d0 = r0; // tangent
+	Point mid = v * d0 + arc0.m_v.m_c;
+	Point left = mid, right = mid;
+	int num_circle = 1;
+	if(h >= tolerance * tolerance)
+	{
+		h = sqrt(h);
+		right = ~v * h + mid;
+		left = ~v * -h + mid;
+		num_circle = 2;
+	}
+
+	int num = 0;
+	if(OnArc(arc0, left) && OnArc(arc1, left))p0 = left, num++;
+	if(num_circle == 2 && OnArc(arc0, right) && OnArc(arc1, right))
+	{
+		if(num == 0)p0 = right;
+		else p1 = right;
+		num++;
+	}
+	return num;
+}
+
+static bool IsArc(const Span& span)
+{
+	// very short arcs are treated as lines, as they are by geoff_geometry::Span
+	return span.m_v.m_type != 0 && span.m_p.dist(span.m_v.m_p) > geoff_geometry::TOLERANCE;
+}
+
+static int SpanSpanIntersect(const Span& s0, bool arc0, const Span& s1, bool arc1, Point& p0, Point& p1)
+{
+	if(!arc0)
+	{
+		if(!arc1)return LineLineIntersect(s0.m_p, s0.m_v.m_p, s1.m_p, s1.m_v.m_p, p0);
+		return LineArcIntersect(s0.m_p, s0.m_v.m_p, s1, p0, p1);
+	}
+	if(!arc1)return LineArcIntersect(s1.m_p, s1.m_v.m_p, s0, p0, p1);
+	return ArcArcIntersect(s0, s1, p0, p1);
+}
+
 void Span::Intersect(const Span& s, std::list<Point> &pts)const
 {
 	// finds all the intersection points between two spans and puts them in the given list
-	geoff_geometry::Point pInt1, pInt2;
-	double t[4];
-	int num_int = MakeSpan(*this).Intof(MakeSpan(s), pInt1, pInt2, t);
-	if(num_int > 0)pts.push_back(Point(pInt1.x, pInt1.y));
-	if(num_int > 1)pts.push_back(Point(pInt2.x, pInt2.y));
+	CBox2D box, s_box;
+	GetBox(box);
+	s.GetBox(s_box);
+	if(BoxesApart(box, s_box))return;
+
+	Point p0, p1;
+	int num_int = SpanSpanIntersect(*this, IsArc(*this), s, IsArc(s), p0, p1);
+	if(num_int > 0)pts.push_back(p0);
+	if(num_int > 1)pts.push_back(p1);
+}
+
+void Span::Intersect(const Span* spans, size_t num_spans, std::list<Point> &pts)const
+{
+	// as Intersect( spans[i], pts ) for each span, working out this span's box and type only once
+	CBox2D box;
+	GetBox(box);
+	const bool arc = IsArc(*this);
+	const double minx = box.MinX() - ApartGap, maxx = box.MaxX() + ApartGap, miny = box.MinY() - ApartGap, maxy = box.MaxY() + ApartGap;
+
+	for(size_t i = 0; i < num_spans; i++)
+	{
+		const Span &s = spans[i];
+		if(!arc && !s.m_v.m_type)
+		{
+			// the common case of a line against a line, without building the other span's box
+			const Point &a = s.m_p;
+			const Point &b = s.m_v.m_p;
+			bool apart = (std::max(a.x, b.x) < minx) | (std::min(a.x, b.x) > maxx) | (std::max(a.y, b.y) < miny) | (std::min(a.y, b.y) > maxy);
+			Point p;
+			if(!apart && LineLineIntersect(m_p, m_v.m_p, a, b, p))pts.push_back(p);
+			continue;
+		}
+
+		CBox2D s_box;
+		s.GetBox(s_box);
+		if(BoxesApart(box, s_box))continue;
+		Point p0, p1;
+		int num_int = SpanSpanIntersect(*this, arc, s, IsArc(s), p0, p1);
+		if(num_int > 0)pts.push_back(p0);
+		if(num_int > 1)pts.push_back(p1);
+	}
+}
+
+int Span::WindingNumber(const Point& p)const
+{
+	// counts the crossings of a ray from p in the +x direction; upwards crossings add one, downwards crossings take one away
+	// an arc is treated as its chord, plus the segment of circle between the chord and the arc
+	const Point &s = m_p;
+	const Point &e = m_v.m_p;
+	double side = (e.x - s.x) * (p.y - s.y) - (p.x - s.x) * (e.y - s.y); // > 0 if p is left of the chord
+
+	int w = 0;
+	if(s.y <= p.y)
+	{
+		if(e.y > p.y && side > 0)w++;
+	}
+	else
+	{
+		if(e.y <= p.y && side < 0)w--;
+	}
+
+	if(m_v.m_type)
+	{
+		// anti-clockwise arcs bulge to the right of their chord, clockwise arcs to the left
+		Point vs = s - m_v.m_c;
+		Point vp = p - m_v.m_c;
+		if(vp * vp < vs * vs)
+		{
+			if(m_v.m_type == CVertex::vt_ccw_arc && side < 0)w++;
+			else if(m_v.m_type == CVertex::vt_cw_arc && side > 0)w--;
+		}
+	}
+
+	return w;
 }
 
 void tangential_arc(const Point &p0, const Point &p1, const Point &v0, Point &c, int &dir)
@@ -50,7 +50,6 @@ inline CVertex::Type reverseArcType(CVertex::Type tt) {
 class Span
 {
 	Point NearestPointNotOnSpan(const Point& p)const;
-	double Parameter(const Point& p)const;
 	Point NearestPointToSpan(const Span& p, double &d, double accuracy)const;
 
 	static const Point null_point;
@@ -73,21 +72,49 @@ public:
 	double Length()const;
 	Point GetVector(double fraction)const;
 	void Intersect(const Span& s, std::list<Point> &pts)const; // finds all the intersection points between two spans
+	void Intersect(const Span* spans, size_t num_spans, std::list<Point> &pts)const; // intersects this span with each of an array of spans
+	double Parameter(const Point& p)const; // 0 to 1 along the span, for a point on the span
+	int WindingNumber(const Point& p)const; // this span's contribution to the winding number of p about its curve
 };
 
 class CArcOrLine;
+class CArcFitBand;
+
+// work counters, for area-bench; only there when built with AREA_COUNTERS defined ( cmake -DAREA_COUNTERS=ON )
+#ifdef AREA_COUNTERS
+#include <atomic>
+#define AREA_COUNT(counter) ((counter)++)
+
+struct CCurveCounters {
+	// how CCurve::Offset got its answer
+	std::atomic<unsigned long> offsets_direct{0};
+	std::atomic<unsigned long> offsets_by_kurve{0};
+	std::atomic<unsigned long> offsets_by_area{0};
+	std::atomic<unsigned long> kurve_exceptions{0}; // exceptions the kurve code threw during KurveOffset
+
+	void Reset(){offsets_direct = 0; offsets_by_kurve = 0; offsets_by_area = 0; kurve_exceptions = 0;}
+};
+#else
+#define AREA_COUNT(counter)
+#endif
 
 class CCurve
 {
 	// a closed curve, please make sure you add an end point, the same as the start point
 
 protected:
-    void AddArcOrLines(bool check_for_arc, std::list<CVertex> &new_vertices, std::list<const CVertex*>& might_be_an_arc, CArcOrLine &arc_or_line, bool &arc_found, bool &arc_added, double accuracy);
-	bool CheckForArc(const CVertex& prev_vt, std::list<const CVertex*>& might_be_an_arc, CArcOrLine &arc_or_line, double accuracy);
+    void AddArcOrLines(bool check_for_arc, std::vector<CVertex> &new_vertices, std::vector<const CVertex*>& might_be_an_arc, CArcFitBand &band, CArcOrLine &arc_or_line, bool &arc_found, bool &arc_added, double accuracy);
+	bool CheckForArc(const CVertex& prev_vt, std::vector<const CVertex*>& might_be_an_arc, CArcFitBand &band, CArcOrLine &arc_or_line, double accuracy);
 
 public:
-	std::list<CVertex> m_vertices;
+	std::vector<CVertex> m_vertices; // contiguous, so walking the spans doesn't chase list nodes
+
+#ifdef AREA_COUNTERS
+	static CCurveCounters counters;
+#endif
+
 	void append(const CVertex& vertex);
+	bool HasArcs()const; // false for a polyline, whose spans can be worked on without looking for arcs. looks through the vertex types each time it is asked
 
 	void FitArcs(double accuracy);
 	void UnFitArcs(double accuracy);
@@ -102,17 +129,21 @@ public:
 	void ChangeStart(const Point &p);
 	void ChangeEnd(const Point &p);
 	bool Offset(double leftwards_value, double accuracy);
+	bool KurveOffset(double leftwards_value); // the offset done through geoff_geometry::Kurve, as it used to be; Offset falls back to it
 	void OffsetForward(double forwards_value, double accuracy, bool refit_arcs = true); // for drag-knife compensation
 	void Break(const Point &p);
 	void ExtractSeparateCurves(const std::list<Point> &ordered_points, std::list<CCurve> &separate_curves)const;
 	double Perim()const;
 	Point PerimToPoint(double perim)const;
+	void PerimToPoints(int num_points, std::vector<Point> &pts)const; // num_points evenly spaced along the curve, from start to end
 	double PointToPerim(const Point& p, double accuracy)const;
 	void GetSpans(std::list<Span> &spans)const;
 	void RemoveTinySpans();
+	void Simplify(double tolerance); // removes line vertices, moving no part of the curve further than tolerance; arcs stay
 	void operator+=(const CCurve& p);
 	void SpanIntersections(const Span& s, std::list<Point> &pts)const;
 	void CurveIntersections(const CCurve& c, std::list<Point> &pts, double accuracy)const;
+	int WindingNumber(const Point& p)const; // an open curve is treated as closed by a line back to its start
 };
 
 void tangential_arc(const Point &p0, const Point &p1, const Point &v0, Point &c, int &dir);
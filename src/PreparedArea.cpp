@@ -0,0 +1,202 @@
+// PreparedArea.cpp
+// This program is released under the BSD license. See the file COPYING for details.
+
+#include "PreparedArea.h"
+
+#include <algorithm>
+#include <memory>
+
+CPreparedArea::CPreparedArea(const CArea& area) : m_nx(0), m_ny(0), m_cell_width(0.0), m_cell_height(0.0)
+{
+	// every span adds its chord; arcs also add the segment of circle between the chord and the arc, as in Span::WindingNumber
+	for(const auto &curve : area.m_curves)
+	{
+		if(curve.m_vertices.size() == 0)continue;
+		const Point *prev_p = nullptr;
+		for(const auto &vertex : curve.m_vertices)
+		{
+			if(prev_p)AddSpan(*prev_p, vertex);
+			prev_p = &(vertex.m_p);
+		}
+		AddSpan(curve.m_vertices.back().m_p, CVertex(curve.m_vertices.front().m_p));
+	}
+
+	std::vector<CBox2D> span_boxes;
+	span_boxes.reserve(m_spans.size());
+	for(const auto &span : m_spans)
+	{
+		CBox2D box;
+		Span(span.m_s, CVertex(static_cast<CVertex::Type>(span.m_dir), span.m_e, span.m_c)).GetBox(box);
+		span_boxes.push_back(box);
+		m_box.Insert(box);
+	}
+
+	if(!m_box.m_valid)return;
+
+	// about one cell per span, with cells roughly square
+	double margin = (m_box.Width() + m_box.Height()) * 1.0e-9 + 1.0e-12;
+	m_box.Insert(m_box.m_minxy - Point(margin, margin));
+	m_box.Insert(m_box.m_maxxy + Point(margin, margin));
+	double width = m_box.Width();
+	double height = m_box.Height();
+	double n = static_cast<double>(std::max<size_t>(m_spans.size(), 1));
+	m_nx = std::max(1, std::min(1024, static_cast<int>(ceil(sqrt(n * width / height)))));
+	m_ny = std::max(1, std::min(1024, static_cast<int>(ceil(sqrt(n * height / width)))));
+	m_cell_width = width / m_nx;
+	m_cell_height = height / m_ny;
+
+	// bucket the spans into the cells their boxes touch, counting first, then filling
+	int num_cells = m_nx * m_ny;
+	m_cell_start.assign(num_cells + 1, 0);
+	for(int pass = 0; pass < 2; pass++)
+	{
+		std::vector<unsigned int> fill;
+		if(pass == 1)
+		{
+			for(int c = 0; c < num_cells; c++)m_cell_start[c + 1] += m_cell_start[c];
+			m_cell_spans.resize(m_cell_start[num_cells]);
+			fill.assign(m_cell_start.begin(), m_cell_start.end() - 1);
+		}
+
+		for(unsigned int s = 0; s < m_spans.size(); s++)
+		{
+			const CBox2D &box = span_boxes[s];
+			int i0 = std::max(0, static_cast<int>((box.MinX() - margin - m_box.MinX()) / m_cell_width));
+			int i1 = std::min(m_nx - 1, static_cast<int>((box.MaxX() + margin - m_box.MinX()) / m_cell_width));
+			int j0 = std::max(0, static_cast<int>((box.MinY() - margin - m_box.MinY()) / m_cell_height));
+			int j1 = std::min(m_ny - 1, static_cast<int>((box.MaxY() + margin - m_box.MinY()) / m_cell_height));
+			for(int j = j0; j <= j1; j++)
+			{
+				for(int i = i0; i <= i1; i++)
+				{
+					int c = j * m_nx + i;
+					if(pass == 0)m_cell_start[c + 1]++;
+					else m_cell_spans[fill[c]++] = s;
+				}
+			}
+		}
+	}
+
+	// find out which reference points are inside, all at once
+	m_cell_ref.resize(num_cells);
+	for(int j = 0; j < m_ny; j++)
+	{
+		for(int i = 0; i < m_nx; i++)
+		{
+			int c = j * m_nx + i;
+			m_cell_ref[c] = ChooseReferencePoint(c, i, j);
+		}
+	}
+
+	std::unique_ptr<bool[]> inside(new bool[num_cells]);
+	::IsInside(m_cell_ref.data(), m_cell_ref.size(), area, inside.get());
+	m_cell_ref_inside.assign(inside.get(), inside.get() + num_cells);
+}
+
+void CPreparedArea::AddSpan(const Point& s, const CVertex& v)
+{
+	PreparedSpan span;
+	span.m_s = s;
+	span.m_e = v.m_p;
+	span.m_c = v.m_c;
+	span.m_dir = v.m_type;
+	Point vs = s - v.m_c;
+	span.m_r2 = v.m_type ? (vs * vs) : 0.0;
+	m_spans.push_back(span);
+}
+
+void CPreparedArea::CellBox(int i, int j, CBox2D &box)const
+{
+	Point p0 = m_box.m_minxy + Point(m_cell_width * i, m_cell_height * j);
+	box = CBox2D(p0, p0 + Point(m_cell_width, m_cell_height));
+}
+
+Point CPreparedArea::ChooseReferencePoint(int cell, int i, int j)const
+{
+	// the reference point mustn't be on a span, or the answer for it would be ambiguous
+	// try a few points around the centre of the cell and use the one furthest from the cell's spans
+	static const double offsets[][2] = {{0.0, 0.0}, {0.1234, 0.2718}, {-0.3183, 0.1414}, {0.2236, -0.3606}, {-0.1732, -0.2449}};
+	CBox2D box;
+	CellBox(i, j, box);
+	double wanted_clearance = (m_cell_width + m_cell_height) * 1.0e-6;
+
+	Point best_point = box.Centre();
+	double best_clearance = -1.0;
+	for(const auto &offset : offsets)
+	{
+		Point p = box.Centre() + Point(offset[0] * m_cell_width, offset[1] * m_cell_height);
+		double clearance = -1.0;
+		for(unsigned int k = m_cell_start[cell]; k < m_cell_start[cell + 1]; k++)
+		{
+			const PreparedSpan &span = m_spans[m_cell_spans[k]];
+			double d = Span(span.m_s, CVertex(span.m_e)).NearestPoint(p).dist(p);
+			if(span.m_dir)d = std::min(d, fabs(p.dist(span.m_c) - sqrt(span.m_r2)));
+			if(clearance < 0.0 || d < clearance)clearance = d;
+		}
+		if(clearance < 0.0 || clearance > wanted_clearance)return p;
+		if(clearance > best_clearance)
+		{
+			best_clearance = clearance;
+			best_point = p;
+		}
+	}
+	return best_point;
+}
+
+int CPreparedArea::Crossings(const PreparedSpan& span, const Point& c, const Point& p)const
+{
+	// the change in winding number, from c to p, due to this span.
+	// this is the ray test of Span::WindingNumber, done along the line from c through p, from both ends
+	int w = 0;
+	Point d = p - c;
+	double hs = d ^ (span.m_s - c);
+	double he = d ^ (span.m_e - c);
+	Point v = span.m_e - span.m_s;
+	double side_c = v ^ (c - span.m_s);
+	double side_p = v ^ (p - span.m_s);
+
+	if(hs <= 0)
+	{
+		if(he > 0)w += (side_p > 0) - (side_c > 0);
+	}
+	else
+	{
+		if(he <= 0)w -= (side_p < 0) - (side_c < 0);
+	}
+
+	if(span.m_dir)
+	{
+		Point vc = c - span.m_c;
+		Point vp = p - span.m_c;
+		int in_c = (vc * vc < span.m_r2) && (side_c * span.m_dir < 0);
+		int in_p = (vp * vp < span.m_r2) && (side_p * span.m_dir < 0);
+		w += span.m_dir * (in_p - in_c);
+	}
+
+	return w;
+}
+
+bool CPreparedArea::IsInside(const Point& p)const
+{
+	if(!m_box.m_valid)return false;
+	if(p.x < m_box.MinX() || p.x > m_box.MaxX() || p.y < m_box.MinY() || p.y > m_box.MaxY())return false;
+
+	int i = std::min(m_nx - 1, static_cast<int>((p.x - m_box.MinX()) / m_cell_width));
+	int j = std::min(m_ny - 1, static_cast<int>((p.y - m_box.MinY()) / m_cell_height));
+	int cell = j * m_nx + i;
+
+	// only spans in this cell can cross the line from the reference point to p
+	const Point &c = m_cell_ref[cell];
+	int w = 0;
+	for(unsigned int k = m_cell_start[cell]; k < m_cell_start[cell + 1]; k++)
+	{
+		w += Crossings(m_spans[m_cell_spans[k]], c, p);
+	}
+
+	return (m_cell_ref_inside[cell] != 0) != ((w & 1) != 0);
+}
+
+void CPreparedArea::IsInside(const Point* pts, size_t num_pts, bool* inside)const
+{
+	for(size_t i = 0; i < num_pts; i++)inside[i] = IsInside(pts[i]);
+}
@@ -0,0 +1,45 @@
+// PreparedArea.h
+// This program is released under the BSD license. See the file COPYING for details.
+
+#pragma once
+
+#include "Area.h"
+#include <vector>
+
+// an inside/outside index built once from an area, for answering many point queries against it.
+// the area's spans are bucketed into a uniform grid, and each cell has a reference point whose
+// inside/outside state is worked out when the index is built; a query only looks at the spans in its own cell.
+// all the query functions are const and touch no shared state, so one CPreparedArea can be used from many threads.
+class CPreparedArea
+{
+	struct PreparedSpan
+	{
+		Point m_s, m_e, m_c;
+		double m_r2; // radius squared, for arcs
+		int m_dir; // 0 for a line, 1 for an anti-clockwise arc, -1 for a clockwise arc
+	};
+
+	std::vector<PreparedSpan> m_spans;
+	CBox2D m_box;
+	int m_nx, m_ny;
+	double m_cell_width, m_cell_height;
+	std::vector<unsigned int> m_cell_start; // m_cell_spans[m_cell_start[i]] to m_cell_spans[m_cell_start[i+1]] are the spans in cell i
+	std::vector<unsigned int> m_cell_spans;
+	std::vector<Point> m_cell_ref; // reference point of each cell
+	std::vector<char> m_cell_ref_inside;
+
+	void AddSpan(const Point& s, const CVertex& v);
+	void CellBox(int i, int j, CBox2D &box)const;
+	Point ChooseReferencePoint(int cell, int i, int j)const;
+	int Crossings(const PreparedSpan& span, const Point& c, const Point& p)const;
+
+public:
+	CPreparedArea(const CArea& area);
+
+	bool IsInside(const Point& p)const;
+	void IsInside(const Point* pts, size_t num_pts, bool* inside)const;
+
+	size_t num_spans()const{return m_spans.size();}
+	size_t num_cells()const{return m_cell_ref.size();}
+	size_t num_span_references()const{return m_cell_spans.size();}
+};
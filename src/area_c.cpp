@@ -145,14 +145,13 @@ extern "C" AreaVertexInfo area_input_vertex(AreaRef area, int curve_idx, int ver
     const CCurve* c = inputCurveAt(area, curve_idx);
     if (!c) return zero;
     if (vertex_idx < 0 || vertex_idx >= static_cast<int>(c->m_vertices.size())) return zero;
-    auto it = c->m_vertices.begin();
-    std::advance(it, vertex_idx);
+    const CVertex& v = c->m_vertices[vertex_idx];
     AreaVertexInfo vi;
-    vi.x    = it->m_p.x;
-    vi.y    = it->m_p.y;
-    vi.cx   = it->m_c.x;
-    vi.cy   = it->m_c.y;
-    vi.type = static_cast<int>(it->m_type);
+    vi.x    = v.m_p.x;
+    vi.y    = v.m_p.y;
+    vi.cx   = v.m_c.x;
+    vi.cy   = v.m_c.y;
+    vi.type = static_cast<int>(v.m_type);
     return vi;
 }
 
@@ -4,6 +4,20 @@
 
 #include "dxf.h"
 
+#include <charconv>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using std::endl;
 using std::ifstream;
 using std::ios;
@@ -12,65 +26,200 @@ using std::ofstream;
 using std::string;
 static const double Pi = 3.14159265358979323846264338327950288419716939937511;
 
-CDxfWrite::CDxfWrite(const char* filepath)
+// SPLINE counts above this aren't trusted to reserve space for
+static constexpr int MaxSplineReserve = 1000000;
+
+// what CDxfWrite keeps before writing it to the file
+static constexpr size_t WriteBufferBytes = 1 << 20;
+
+// ENTITIES sections smaller than this are read on one thread
+static constexpr size_t MinBytesForThreads = 2000000;
+static constexpr size_t MinChunkBytes = 256000;
+static constexpr size_t MaxChunkBytes = 4000000;
+
+// the layer and colour from before a chunk, not known while it is read; get_line can't give a newline
+static const char* const UnknownLayer = "\n";
+static const Aci_t UnknownAci = std::numeric_limits<Aci_t>::min();
+
+
+// the start of an AutoCAD binary DXF, with the 0 at the end of the string, 22 bytes in all
+static const char BinarySentinel[] = "AutoCAD Binary DXF\r\n\x1a";
+
+// how a value is stored in a binary DXF, which depends on its group code
+enum BinaryType
+{
+	eBinaryString,
+	eBinaryDouble,
+	eBinaryInt16,
+	eBinaryInt32,
+	eBinaryInt64,
+	eBinaryBool,
+	eBinaryChunk // a length byte, then that many bytes
+};
+
+static BinaryType GetBinaryType(int code)
+{
+	if(code < 10)return eBinaryString;
+	if(code < 60)return eBinaryDouble;
+	if(code < 80)return eBinaryInt16;
+	if(code >= 90 && code < 100)return eBinaryInt32;
+	if(code >= 110 && code < 150)return eBinaryDouble;
+	if(code >= 160 && code < 170)return eBinaryInt64;
+	if(code >= 170 && code < 180)return eBinaryInt16;
+	if(code >= 210 && code < 240)return eBinaryDouble;
+	if(code >= 270 && code < 290)return eBinaryInt16;
+	if(code >= 290 && code < 300)return eBinaryBool;
+	if(code >= 310 && code < 320)return eBinaryChunk;
+	if(code >= 370 && code < 390)return eBinaryInt16;
+	if(code >= 400 && code < 410)return eBinaryInt16;
+	if((code >= 420 && code < 430) || (code >= 440 && code < 460))return eBinaryInt32;
+	if(code >= 460 && code < 470)return eBinaryDouble;
+	if(code == 1004)return eBinaryChunk;
+	if(code >= 1010 && code < 1060)return eBinaryDouble;
+	if(code >= 1060 && code < 1071)return eBinaryInt16;
+	if(code == 1071)return eBinaryInt32;
+	return eBinaryString;
+}
+
+CDxfWrite::CDxfWrite(const char* filepath, bool binary)
 {
 	// start the file
 	m_fail = false;
-	m_ofs = std::make_unique<ofstream>(filepath, ios::out);
+	m_binary = binary;
+	m_used = 0;
+	m_ofs = std::make_unique<ofstream>(filepath, binary ? (ios::out | ios::binary) : ios::out);
 	if(!(*m_ofs)){
 		m_fail = true;
 		return;
 	}
-	m_ofs->imbue(std::locale("C"));
+	m_buffer.resize(WriteBufferBytes);
 
 	// start
-	(*m_ofs) << 0          << endl;
-	(*m_ofs) << "SECTION"  << endl;
-	(*m_ofs) << 2          << endl;
-	(*m_ofs) << "ENTITIES" << endl;
+	if(m_binary)Put(BinarySentinel, sizeof(BinarySentinel));
+	WriteGroup(0, "SECTION");
+	WriteGroup(2, "ENTITIES");
 }
 
 CDxfWrite::~CDxfWrite()
 {
+	if(m_fail)return;
+
 	// end
-	(*m_ofs) << 0          << endl;
-	(*m_ofs) << "ENDSEC"   << endl;
-	(*m_ofs) << 0          << endl;
-	(*m_ofs) << "EOF";
+	WriteGroup(0, "ENDSEC");
+	if(m_binary){
+		WriteGroup(0, "EOF");
+	}
+	else{
+		WriteCode(0);
+		Put("EOF", 3);
+	}
+	Flush();
+}
+
+void CDxfWrite::Put(const char* data, size_t size)
+{
+	if(m_fail)return;
+	if(m_used + size > m_buffer.size())
+	{
+		Flush();
+		if(size > m_buffer.size()){
+			if(!m_ofs->write(data, size))m_fail = true;
+			return;
+		}
+	}
+	memcpy(m_buffer.data() + m_used, data, size);
+	m_used += size;
+}
+
+void CDxfWrite::Flush()
+{
+	if(m_used > 0 && !m_ofs->write(m_buffer.data(), m_used))m_fail = true;
+	m_used = 0;
+	if(!m_ofs->flush())m_fail = true;
+}
+
+void CDxfWrite::WriteCode(int code)
+{
+	if(m_binary){
+		// two bytes, little endian
+		char c[2] = {static_cast<char>(code & 0xff), static_cast<char>(code >> 8)};
+		Put(c, 2);
+		return;
+	}
+	char c[8];
+	char* end = std::to_chars(c, c + sizeof(c) - 1, code).ptr;
+	*end++ = '\n';
+	Put(c, end - c);
+}
+
+void CDxfWrite::WriteGroup(int code, const char* value)
+{
+	// in a binary file, the string is ended by a 0, rather than a newline
+	WriteCode(code);
+	Put(value, strlen(value));
+	Put(m_binary ? "" : "\n", 1);
+}
+
+void CDxfWrite::WriteGroup(int code, double value)
+{
+	// the codes written with a double all store one in a binary file
+	WriteCode(code);
+	if(m_binary){
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		char c[8];
+		for(int i = 0; i < 8; i++)c[i] = static_cast<char>(bits >> (8 * i)); // little endian
+		Put(c, 8);
+		return;
+	}
+
+	// the shortest text that reads back as the same double
+	char c[40];
+#ifdef __cpp_lib_to_chars
+	char* end = std::to_chars(c, c + sizeof(c) - 1, value).ptr;
+#else
+	char* end = c + snprintf(c, sizeof(c) - 1, "%.17g", value);
+#endif
+	*end++ = '\n';
+	Put(c, end - c);
+}
+
+void CDxfWrite::WriteGroup(int code, int value)
+{
+	WriteCode(code);
+	if(m_binary){
+		// 32 bits for the codes that have them, otherwise 16
+		int bytes = (GetBinaryType(code) == eBinaryInt32) ? 4 : 2;
+		char c[4];
+		for(int i = 0; i < bytes; i++)c[i] = static_cast<char>(static_cast<unsigned int>(value) >> (8 * i));
+		Put(c, bytes);
+		return;
+	}
+	char c[16];
+	char* end = std::to_chars(c, c + sizeof(c) - 1, value).ptr;
+	*end++ = '\n';
+	Put(c, end - c);
 }
 
 void CDxfWrite::WriteLine(const double* s, const double* e, const char* layer_name)
 {
-	(*m_ofs) << 0			<< endl;
-	(*m_ofs) << "LINE"		<< endl;
-	(*m_ofs) << 8			<< endl;	// Group code for layer name
-	(*m_ofs) << layer_name	<< endl;	// Layer number
-	(*m_ofs) << 10			<< endl;	// Start point of line
-	(*m_ofs) << s[0]		<< endl;	// X in WCS coordinates
-	(*m_ofs) << 20			<< endl;
-	(*m_ofs) << s[1]		<< endl;	// Y in WCS coordinates
-	(*m_ofs) << 30			<< endl;
-	(*m_ofs) << s[2]		<< endl;	// Z in WCS coordinates
-	(*m_ofs) << 11			<< endl;	// End point of line
-	(*m_ofs) << e[0]		<< endl;	// X in WCS coordinates
-	(*m_ofs) << 21			<< endl;
-	(*m_ofs) << e[1]		<< endl;	// Y in WCS coordinates
-	(*m_ofs) << 31			<< endl;
-	(*m_ofs) << e[2]		<< endl;	// Z in WCS coordinates
+	WriteGroup(0, "LINE");
+	WriteGroup(8, layer_name);	// Layer name
+	WriteGroup(10, s[0]);		// Start point of line, X in WCS coordinates
+	WriteGroup(20, s[1]);		// Y in WCS coordinates
+	WriteGroup(30, s[2]);		// Z in WCS coordinates
+	WriteGroup(11, e[0]);		// End point of line, X in WCS coordinates
+	WriteGroup(21, e[1]);		// Y in WCS coordinates
+	WriteGroup(31, e[2]);		// Z in WCS coordinates
 }
 
 void CDxfWrite::WritePoint(const double* s, const char* layer_name)
 {
-	(*m_ofs) << 0			<< endl;
-	(*m_ofs) << "POINT"		<< endl;
-	(*m_ofs) << 8			<< endl;	// Group code for layer name
-	(*m_ofs) << layer_name	<< endl;	// Layer number
-	(*m_ofs) << 10			<< endl;	// Start point of line
-	(*m_ofs) << s[0]		<< endl;	// X in WCS coordinates
-	(*m_ofs) << 20			<< endl;
-	(*m_ofs) << s[1]		<< endl;	// Y in WCS coordinates
-	(*m_ofs) << 30			<< endl;
-	(*m_ofs) << s[2]		<< endl;	// Z in WCS coordinates
+	WriteGroup(0, "POINT");
+	WriteGroup(8, layer_name);	// Layer name
+	WriteGroup(10, s[0]);		// X in WCS coordinates
+	WriteGroup(20, s[1]);		// Y in WCS coordinates
+	WriteGroup(30, s[2]);		// Z in WCS coordinates
 }
 
 void CDxfWrite::WriteArc(const double* s, const double* e, const double* c, bool dir, const char* layer_name)
@@ -88,38 +237,24 @@ void CDxfWrite::WriteArc(const double* s, const double* e, const double* c, bool
 		start_angle = end_angle;
 		end_angle = temp;
 	}
-	(*m_ofs) << 0			<< endl;
-	(*m_ofs) << "ARC"		<< endl;
-	(*m_ofs) << 8			<< endl;	// Group code for layer name
-	(*m_ofs) << layer_name	<< endl;	// Layer number
-	(*m_ofs) << 10			<< endl;	// Centre X
-	(*m_ofs) << c[0]		<< endl;	// X in WCS coordinates
-	(*m_ofs) << 20			<< endl;
-	(*m_ofs) << c[1]		<< endl;	// Y in WCS coordinates
-	(*m_ofs) << 30			<< endl;
-	(*m_ofs) << c[2]		<< endl;	// Z in WCS coordinates
-	(*m_ofs) << 40			<< endl;	//
-	(*m_ofs) << radius		<< endl;	// Radius
-	(*m_ofs) << 50			<< endl;
-	(*m_ofs) << start_angle	<< endl;	// Start angle
-	(*m_ofs) << 51			<< endl;
-	(*m_ofs) << end_angle	<< endl;	// End angle
+	WriteGroup(0, "ARC");
+	WriteGroup(8, layer_name);	// Layer name
+	WriteGroup(10, c[0]);		// Centre, X in WCS coordinates
+	WriteGroup(20, c[1]);		// Y in WCS coordinates
+	WriteGroup(30, c[2]);		// Z in WCS coordinates
+	WriteGroup(40, radius);		// Radius
+	WriteGroup(50, start_angle);	// Start angle
+	WriteGroup(51, end_angle);	// End angle
 }
 
 void CDxfWrite::WriteCircle(const double* c, double radius, const char* layer_name)
 {
-	(*m_ofs) << 0			<< endl;
-	(*m_ofs) << "CIRCLE"		<< endl;
-	(*m_ofs) << 8			<< endl;	// Group code for layer name
-	(*m_ofs) << layer_name	<< endl;	// Layer number
-	(*m_ofs) << 10			<< endl;	// Centre X
-	(*m_ofs) << c[0]		<< endl;	// X in WCS coordinates
-	(*m_ofs) << 20			<< endl;
-	(*m_ofs) << c[1]		<< endl;	// Y in WCS coordinates
-	(*m_ofs) << 30			<< endl;
-	(*m_ofs) << c[2]		<< endl;	// Z in WCS coordinates
-	(*m_ofs) << 40			<< endl;	//
-	(*m_ofs) << radius		<< endl;	// Radius
+	WriteGroup(0, "CIRCLE");
+	WriteGroup(8, layer_name);	// Layer name
+	WriteGroup(10, c[0]);		// Centre, X in WCS coordinates
+	WriteGroup(20, c[1]);		// Y in WCS coordinates
+	WriteGroup(30, c[2]);		// Z in WCS coordinates
+	WriteGroup(40, radius);		// Radius
 }
 
 void CDxfWrite::WriteEllipse(const double* c, double major_radius, double minor_radius, double rotation, double start_angle, double end_angle, bool dir, const char* layer_name )
@@ -136,46 +271,145 @@ void CDxfWrite::WriteEllipse(const double* c, double major_radius, double minor_
 		start_angle = end_angle;
 		end_angle = temp;
 	}
-	(*m_ofs) << 0			<< endl;
-	(*m_ofs) << "ELLIPSE"		<< endl;
-	(*m_ofs) << 8			<< endl;	// Group code for layer name
-	(*m_ofs) << layer_name	<< endl;	// Layer number
-	(*m_ofs) << 10			<< endl;	// Centre X
-	(*m_ofs) << c[0]		<< endl;	// X in WCS coordinates
-	(*m_ofs) << 20			<< endl;
-	(*m_ofs) << c[1]		<< endl;	// Y in WCS coordinates
-	(*m_ofs) << 30			<< endl;
-	(*m_ofs) << c[2]		<< endl;	// Z in WCS coordinates
-	(*m_ofs) << 40			<< endl;	//
-	(*m_ofs) << ratio		<< endl;	// Ratio
-	(*m_ofs) << 11			<< endl;	//
-	(*m_ofs) << m[0]		<< endl;	// Major X
-	(*m_ofs) << 21			<< endl;
-	(*m_ofs) << m[1]		<< endl;	// Major Y
-	(*m_ofs) << 31			<< endl;
-	(*m_ofs) << m[2]		<< endl;	// Major Z
-	(*m_ofs) << 41		<< endl;
-	(*m_ofs) << start_angle	<< endl;	// Start angle
-	(*m_ofs) << 42		<< endl;
-	(*m_ofs) << end_angle	<< endl;	// End angle
+	WriteGroup(0, "ELLIPSE");
+	WriteGroup(8, layer_name);	// Layer name
+	WriteGroup(10, c[0]);		// Centre, X in WCS coordinates
+	WriteGroup(20, c[1]);		// Y in WCS coordinates
+	WriteGroup(30, c[2]);		// Z in WCS coordinates
+	WriteGroup(40, ratio);		// Ratio
+	WriteGroup(11, m[0]);		// Major X
+	WriteGroup(21, m[1]);		// Major Y
+	WriteGroup(31, m[2]);		// Major Z
+	WriteGroup(41, start_angle);	// Start angle
+	WriteGroup(42, end_angle);	// End angle
+}
+
+void CDxfWrite::WriteLwPolyLine(const double* xy, const double* bulges, int num_points, bool closed, const char* layer_name )
+{
+	WriteGroup(0, "LWPOLYLINE");
+	WriteGroup(8, layer_name);	// Layer name
+	WriteGroup(90, num_points);	// Number of vertices
+	WriteGroup(70, closed ? 1 : 0);	// Flags, 1 for closed
+	for(int i = 0; i < num_points; i++)
+	{
+		WriteGroup(10, xy[2 * i]);	// X in OCS coordinates
+		WriteGroup(20, xy[2 * i + 1]);	// Y in OCS coordinates
+		if(bulges && bulges[i] != 0.0)WriteGroup(42, bulges[i]);	// Bulge of the span from this vertex
+	}
+}
+
+CDxfFile::CDxfFile(const char* filepath)
+{
+	m_data = nullptr;
+	m_size = 0;
+	m_fail = false;
+	m_mapped = false;
+
+#ifndef _WIN32
+	int fd = open(filepath, O_RDONLY);
+	if(fd < 0){
+		m_fail = true;
+		return;
+	}
+	struct stat st;
+	if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p != MAP_FAILED)
+		{
+			madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+			m_data = static_cast<const char*>(p);
+			m_size = static_cast<size_t>(st.st_size);
+			m_mapped = true;
+		}
+	}
+	close(fd);
+	if(m_mapped)return;
+#endif
+
+	// an empty file, or one that can't be mapped, is read into memory
+	ifstream ifs(filepath, ios::in | ios::binary);
+	if(!ifs){
+		m_fail = true;
+		return;
+	}
+	m_buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+}
+
+CDxfFile::~CDxfFile()
+{
+#ifndef _WIN32
+	if(m_mapped)munmap(const_cast<char*>(m_data), m_size);
+#endif
 }
 
 CDxfRead::CDxfRead(const char* filepath)
 {
 	// start the file
-	memset( m_unused_line, '\0', sizeof(m_unused_line) );
+	m_line_unused = false;
+	m_pos = 0;
+	m_eof = false;
 	m_fail = false;
 	m_eUnits = eMillimeters;
-	strcpy(m_layer_name, "0");	// Default layer name
+	m_layer_name = "0";	// Default layer name
 	m_ignore_errors = true;
-
-	m_ifs = std::make_unique<ifstream>(filepath);
-	if(!(*m_ifs)){
+	m_entities_only = false;
+	m_read_threads = 1;
+	m_aci = 256;
+	m_in_chunk = false;
+	m_needs_start_aci = false;
+	m_reread = false;
+	m_binary = false;
+	m_binary_short_codes = false;
+	m_binary_code = -1;
+	m_is_number = false;
+	m_number = 0.0;
+
+	m_file = std::make_shared<CDxfFile>(filepath);
+	m_end = m_file->Size();
+	if(m_file->Failed()){
 		m_fail = true;
 		return;
 	}
-	m_ifs->imbue(std::locale("C"));
 
+	if(m_end >= sizeof(BinarySentinel) && memcmp(m_file->Data(), BinarySentinel, sizeof(BinarySentinel)) == 0)
+	{
+		// the first group is 0 SECTION; its code is two 0 bytes, unless the codes are one byte
+		m_binary = true;
+		m_pos = sizeof(BinarySentinel);
+		m_binary_short_codes = (m_end > m_pos + 1 && m_file->Data()[m_pos + 1] != 0);
+	}
+}
+
+CDxfRead::CDxfRead(const CDxfRead& reader, size_t begin, size_t end)
+{
+	// reads [begin, end) of reader's file, with its units and layers, for CDxfChunkRead
+	m_file = reader.m_file;
+	m_pos = begin;
+	m_end = end;
+	m_eof = false;
+	m_line_unused = false;
+	m_fail = false;
+	m_eUnits = reader.m_eUnits;
+	m_layer_name = reader.m_layer_name;
+	m_section_name = reader.m_section_name;
+	m_block_name = reader.m_block_name;
+	m_ignore_errors = reader.m_ignore_errors;
+	m_layer_filter = reader.m_layer_filter;
+	m_entities_only = reader.m_entities_only;
+	m_read_threads = 1;
+	m_layer_aci = reader.m_layer_aci;
+	m_aci = reader.m_aci;
+	m_in_chunk = true;
+	m_needs_start_aci = false;
+	m_reread = false;
+	m_binary = reader.m_binary;
+	m_binary_short_codes = reader.m_binary_short_codes;
+	m_binary_code = -1;
+	m_is_number = false;
+	m_number = 0.0;
 }
 
 CDxfRead::~CDxfRead()
@@ -217,19 +451,17 @@ bool CDxfRead::ReadLine()
 	double s[3] = {0, 0, 0};
 	double e[3] = {0, 0, 0};
 
-	while(!((*m_ifs).eof()))
+	while(!m_eof)
 	{
 		get_line();
 		int n;
 
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-		    printf("CDxfRead::ReadLine() Failed to read integer from '%s'\n", m_str );
+		    Report("CDxfRead::ReadLine() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data() );
 		    return false;
 		}
 
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:
 				// next item found, so finish with line
@@ -239,43 +471,49 @@ bool CDxfRead::ReadLine()
 
 			case 8: // Layer name follows
 				get_line();
-				strcpy(m_layer_name, m_str);
+				m_layer_name = m_str;
 				break;
 
 			case 10:
 				// start x
 				get_line();
-				ss.str(m_str); ss >> s[0]; s[0] = mm(s[0]); if(ss.fail()) return false;
+				if(!ParseValue(s[0])) return false;
+				s[0] = mm(s[0]);
 				break;
 			case 20:
 				// start y
 				get_line();
-				ss.str(m_str); ss >> s[1]; s[1] = mm(s[1]); if(ss.fail()) return false;
+				if(!ParseValue(s[1])) return false;
+				s[1] = mm(s[1]);
 				break;
 			case 30:
 				// start z
 				get_line();
-				ss.str(m_str); ss >> s[2]; s[2] = mm(s[2]); if(ss.fail()) return false;
+				if(!ParseValue(s[2])) return false;
+				s[2] = mm(s[2]);
 				break;
 			case 11:
 				// end x
 				get_line();
-				ss.str(m_str); ss >> e[0]; e[0] = mm(e[0]); if(ss.fail()) return false;
+				if(!ParseValue(e[0])) return false;
+				e[0] = mm(e[0]);
 				break;
 			case 21:
 				// end y
 				get_line();
-				ss.str(m_str); ss >> e[1]; e[1] = mm(e[1]); if(ss.fail()) return false;
+				if(!ParseValue(e[1])) return false;
+				e[1] = mm(e[1]);
 				break;
 			case 31:
 				// end z
 				get_line();
-				ss.str(m_str); ss >> e[2]; e[2] = mm(e[2]); if(ss.fail()) return false;
+				if(!ParseValue(e[2])) return false;
+				e[2] = mm(e[2]);
 				break;
 		        case 62:
 				// color index
 				get_line();
-				ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+				if(!ParseValue(m_aci)) return false;
 				break;
 
 			case 100:
@@ -309,19 +547,17 @@ bool CDxfRead::ReadPoint()
 {
 	double s[3] = {0, 0, 0};
 
-	while(!((*m_ifs).eof()))
+	while(!m_eof)
 	{
 		get_line();
 		int n;
 
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-		    printf("CDxfRead::ReadPoint() Failed to read integer from '%s'\n", m_str );
+		    Report("CDxfRead::ReadPoint() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data() );
 		    return false;
 		}
 
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:
 				// next item found, so finish with line
@@ -331,29 +567,32 @@ bool CDxfRead::ReadPoint()
 
 			case 8: // Layer name follows
 				get_line();
-				strcpy(m_layer_name, m_str);
+				m_layer_name = m_str;
 				break;
 
 			case 10:
 				// start x
 				get_line();
-				ss.str(m_str); ss >> s[0]; s[0] = mm(s[0]); if(ss.fail()) return false;
+				if(!ParseValue(s[0])) return false;
+				s[0] = mm(s[0]);
 				break;
 			case 20:
 				// start y
 				get_line();
-				ss.str(m_str); ss >> s[1]; s[1] = mm(s[1]); if(ss.fail()) return false;
+				if(!ParseValue(s[1])) return false;
+				s[1] = mm(s[1]);
 				break;
 			case 30:
 				// start z
 				get_line();
-				ss.str(m_str); ss >> s[2]; s[2] = mm(s[2]); if(ss.fail()) return false;
+				if(!ParseValue(s[2])) return false;
+				s[2] = mm(s[2]);
 				break;
 
 		        case 62:
 				// color index
 				get_line();
-				ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+				if(!ParseValue(m_aci)) return false;
 				break;
 
 			case 100:
@@ -391,18 +630,16 @@ bool CDxfRead::ReadArc()
 	double radius = 0.0;
 	double c[3]; // centre
 
-	while(!((*m_ifs).eof()))
+	while(!m_eof)
 	{
 		get_line();
 		int n;
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-		    printf("CDxfRead::ReadArc() Failed to read integer from '%s'\n", m_str);
+		    Report("CDxfRead::ReadArc() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
 		    return false;
 		}
 
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:
 				// next item found, so finish with arc
@@ -412,43 +649,47 @@ bool CDxfRead::ReadArc()
 
 			case 8: // Layer name follows
 				get_line();
-				strcpy(m_layer_name, m_str);
+				m_layer_name = m_str;
 				break;
 
 			case 10:
 				// centre x
 				get_line();
-				ss.str(m_str); ss >> c[0]; c[0] = mm(c[0]); if(ss.fail()) return false;
+				if(!ParseValue(c[0])) return false;
+				c[0] = mm(c[0]);
 				break;
 			case 20:
 				// centre y
 				get_line();
-				ss.str(m_str); ss >> c[1]; c[1] = mm(c[1]); if(ss.fail()) return false;
+				if(!ParseValue(c[1])) return false;
+				c[1] = mm(c[1]);
 				break;
 			case 30:
 				// centre z
 				get_line();
-				ss.str(m_str); ss >> c[2]; c[2] = mm(c[2]); if(ss.fail()) return false;
+				if(!ParseValue(c[2])) return false;
+				c[2] = mm(c[2]);
 				break;
 			case 40:
 				// radius
 				get_line();
-				ss.str(m_str); ss >> radius; radius = mm(radius); if(ss.fail()) return false;
+				if(!ParseValue(radius)) return false;
+				radius = mm(radius);
 				break;
 			case 50:
 				// start angle
 				get_line();
-				ss.str(m_str); ss >> start_angle; if(ss.fail()) return false;
+				if(!ParseValue(start_angle)) return false;
 				break;
 			case 51:
 				// end angle
 				get_line();
-				ss.str(m_str); ss >> end_angle; if(ss.fail()) return false;
+				if(!ParseValue(end_angle)) return false;
 				break;
 		        case 62:
 				// color index
 				get_line();
-				ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+				if(!ParseValue(m_aci)) return false;
 				break;
 			case 100:
 			case 39:
@@ -483,17 +724,15 @@ bool CDxfRead::ReadSpline()
 
 	double temp_double;
 
-	while(!((*m_ifs).eof()))
+	while(!m_eof)
 	{
 		get_line();
 		int n;
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-		    printf("CDxfRead::ReadSpline() Failed to read integer from '%s'\n", m_str);
+		    Report("CDxfRead::ReadSpline() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
 		    return false;
 		}
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:
 				// next item found, so finish with Spline
@@ -502,136 +741,152 @@ bool CDxfRead::ReadSpline()
 				return true;
 			case 8: // Layer name follows
 				get_line();
-				strcpy(m_layer_name, m_str);
+				m_layer_name = m_str;
 				break;
 		        case 62:
 				// color index
 				get_line();
-				ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+				if(!ParseValue(m_aci)) return false;
 				break;
 			case 210:
 				// normal x
 				get_line();
-				ss.str(m_str); ss >> sd.norm[0]; sd.norm[0] = mm(sd.norm[0]); if(ss.fail()) return false;
+				if(!ParseValue(sd.norm[0])) return false;
+				sd.norm[0] = mm(sd.norm[0]);
 				break;
 			case 220:
 				// normal y
 				get_line();
-				ss.str(m_str); ss >> sd.norm[1]; sd.norm[1] = mm(sd.norm[1]); if(ss.fail()) return false;
+				if(!ParseValue(sd.norm[1])) return false;
+				sd.norm[1] = mm(sd.norm[1]);
 				break;
 			case 230:
 				// normal z
 				get_line();
-				ss.str(m_str); ss >> sd.norm[2]; sd.norm[2] = mm(sd.norm[2]); if(ss.fail()) return false;
+				if(!ParseValue(sd.norm[2])) return false;
+				sd.norm[2] = mm(sd.norm[2]);
 				break;
 			case 70:
 				// flag
 				get_line();
-				ss.str(m_str); ss >> sd.flag; if(ss.fail()) return false;
+				if(!ParseValue(sd.flag)) return false;
 				break;
 			case 71:
 				// degree
 				get_line();
-				ss.str(m_str); ss >> sd.degree; if(ss.fail()) return false;
+				if(!ParseValue(sd.degree)) return false;
 				break;
 			case 72:
 				// knots
 				get_line();
-				ss.str(m_str); ss >> sd.knots; if(ss.fail()) return false;
+				if(!ParseValue(sd.knots)) return false;
+				if(sd.knots > 0 && sd.knots < MaxSplineReserve)sd.knot.reserve(sd.knots);
 				break;
 			case 73:
 				// control points
 				get_line();
-				ss.str(m_str); ss >> sd.control_points; if(ss.fail()) return false;
+				if(!ParseValue(sd.control_points)) return false;
+				if(sd.control_points > 0 && sd.control_points < MaxSplineReserve)
+				{
+					sd.controlx.reserve(sd.control_points);
+					sd.controly.reserve(sd.control_points);
+					sd.controlz.reserve(sd.control_points);
+				}
 				break;
 			case 74:
 				// fit points
 				get_line();
-				ss.str(m_str); ss >> sd.fit_points; if(ss.fail()) return false;
+				if(!ParseValue(sd.fit_points)) return false;
+				if(sd.fit_points > 0 && sd.fit_points < MaxSplineReserve)
+				{
+					sd.fitx.reserve(sd.fit_points);
+					sd.fity.reserve(sd.fit_points);
+					sd.fitz.reserve(sd.fit_points);
+				}
 				break;
 			case 12:
 				// starttan x
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
+				if(!ParseValue(temp_double)) return false;
 				sd.starttanx.push_back(temp_double);
 				break;
 			case 22:
 				// starttan y
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
+				if(!ParseValue(temp_double)) return false;
 				sd.starttany.push_back(temp_double);
 				break;
 			case 32:
 				// starttan z
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
+				if(!ParseValue(temp_double)) return false;
 				sd.starttanz.push_back(temp_double);
 				break;
 			case 13:
 				// endtan x
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
+				if(!ParseValue(temp_double)) return false;
 				sd.endtanx.push_back(temp_double);
 				break;
 			case 23:
 				// endtan y
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
+				if(!ParseValue(temp_double)) return false;
 				sd.endtany.push_back(temp_double);
 				break;
 			case 33:
 				// endtan z
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
+				if(!ParseValue(temp_double)) return false;
 				sd.endtanz.push_back(temp_double);
 				break;
 			case 40:
 				// knot
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
+				if(!ParseValue(temp_double)) return false;
 				sd.knot.push_back(temp_double);
 				break;
 			case 41:
 				// weight
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
+				if(!ParseValue(temp_double)) return false;
 				sd.weight.push_back(temp_double);
 				break;
 			case 10:
 				// control x
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
-				sd.controlx.push_back(temp_double);
+				if(!ParseValue(temp_double)) return false;
+				sd.controlx.push_back(mm(temp_double));
 				break;
 			case 20:
 				// control y
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
-				sd.controly.push_back(temp_double);
+				if(!ParseValue(temp_double)) return false;
+				sd.controly.push_back(mm(temp_double));
 				break;
 			case 30:
 				// control z
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
-				sd.controlz.push_back(temp_double);
+				if(!ParseValue(temp_double)) return false;
+				sd.controlz.push_back(mm(temp_double));
 				break;
 			case 11:
 				// fit x
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
-				sd.fitx.push_back(temp_double);
+				if(!ParseValue(temp_double)) return false;
+				sd.fitx.push_back(mm(temp_double));
 				break;
 			case 21:
 				// fit y
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
-				sd.fity.push_back(temp_double);
+				if(!ParseValue(temp_double)) return false;
+				sd.fity.push_back(mm(temp_double));
 				break;
 			case 31:
 				// fit z
 				get_line();
-				ss.str(m_str); ss >> temp_double; if(ss.fail()) return false;
-				sd.fitz.push_back(temp_double);
+				if(!ParseValue(temp_double)) return false;
+				sd.fitz.push_back(mm(temp_double));
 				break;
 			case 42:
 			case 43:
@@ -656,17 +911,15 @@ bool CDxfRead::ReadCircle()
 	double radius = 0.0;
 	double c[3]; // centre
 
-	while(!((*m_ifs).eof()))
+	while(!m_eof)
 	{
 		get_line();
 		int n;
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-		    printf("CDxfRead::ReadCircle() Failed to read integer from '%s'\n", m_str);
+		    Report("CDxfRead::ReadCircle() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
 		    return false;
 		}
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:
 				// next item found, so finish with Circle
@@ -675,33 +928,37 @@ bool CDxfRead::ReadCircle()
 				return true;
 			case 8: // Layer name follows
 				get_line();
-				strcpy(m_layer_name, m_str);
+				m_layer_name = m_str;
 				break;
 
 			case 10:
 				// centre x
 				get_line();
-				ss.str(m_str); ss >> c[0]; c[0] = mm(c[0]); if(ss.fail()) return false;
+				if(!ParseValue(c[0])) return false;
+				c[0] = mm(c[0]);
 				break;
 			case 20:
 				// centre y
 				get_line();
-				ss.str(m_str); ss >> c[1]; c[1] = mm(c[1]); if(ss.fail()) return false;
+				if(!ParseValue(c[1])) return false;
+				c[1] = mm(c[1]);
 				break;
 			case 30:
 				// centre z
 				get_line();
-				ss.str(m_str); ss >> c[2]; c[2] = mm(c[2]); if(ss.fail()) return false;
+				if(!ParseValue(c[2])) return false;
+				c[2] = mm(c[2]);
 				break;
 			case 40:
 				// radius
 				get_line();
-				ss.str(m_str); ss >> radius; radius = mm(radius); if(ss.fail()) return false;
+				if(!ParseValue(radius)) return false;
+				radius = mm(radius);
 				break;
 		        case 62:
 				// color index
 				get_line();
-				ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+				if(!ParseValue(m_aci)) return false;
 				break;
 
 			case 100:
@@ -731,56 +988,58 @@ bool CDxfRead::ReadText()
 
 	memset( c, 0, sizeof(c) );
 
-	while(!((*m_ifs).eof()))
+	while(!m_eof)
 	{
 		get_line();
 		int n;
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-		    printf("CDxfRead::ReadText() Failed to read integer from '%s'\n", m_str);
+		    Report("CDxfRead::ReadText() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
 		    return false;
 		}
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:
 				return false;
 			case 8: // Layer name follows
 				get_line();
-				strcpy(m_layer_name, m_str);
+				m_layer_name = m_str;
 				break;
 
 			case 10:
 				// centre x
 				get_line();
-				ss.str(m_str); ss >> c[0]; c[0] = mm(c[0]); if(ss.fail()) return false;
+				if(!ParseValue(c[0])) return false;
+				c[0] = mm(c[0]);
 				break;
 			case 20:
 				// centre y
 				get_line();
-				ss.str(m_str); ss >> c[1]; c[1] = mm(c[1]); if(ss.fail()) return false;
+				if(!ParseValue(c[1])) return false;
+				c[1] = mm(c[1]);
 				break;
 			case 30:
 				// centre z
 				get_line();
-				ss.str(m_str); ss >> c[2]; c[2] = mm(c[2]); if(ss.fail()) return false;
+				if(!ParseValue(c[2])) return false;
+				c[2] = mm(c[2]);
 				break;
 		        case 40:
 				// text height
 				get_line();
-				ss.str(m_str); ss >> height; height = mm(height); if(ss.fail()) return false;
+				if(!ParseValue(height)) return false;
+				height = mm(height);
 				break;
                        case 1:
 				// text
 				get_line();
 				DerefACI();
-				OnReadText(c, height * 25.4 / 72.0, m_str);
+				OnReadText(c, height * 25.4 / 72.0, std::string(m_str).c_str());
 				return(true);
 
 		        case 62:
 				// color index
 				get_line();
-				ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+				if(!ParseValue(m_aci)) return false;
 				break;
 
 			case 100:
@@ -810,17 +1069,15 @@ bool CDxfRead::ReadEllipse()
 	double start=0; //start of arc
 	double end=0;  // end of arc
 
-	while(!((*m_ifs).eof()))
+	while(!m_eof)
 	{
 		get_line();
 		int n;
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-		    printf("CDxfRead::ReadEllipse() Failed to read integer from '%s'\n", m_str);
+		    Report("CDxfRead::ReadEllipse() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
 		    return false;
 		}
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:
 				// next item found, so finish with Ellipse
@@ -829,58 +1086,64 @@ bool CDxfRead::ReadEllipse()
 				return true;
 			case 8: // Layer name follows
 				get_line();
-				strcpy(m_layer_name, m_str);
+				m_layer_name = m_str;
 				break;
 
 			case 10:
 				// centre x
 				get_line();
-				ss.str(m_str); ss >> c[0]; c[0] = mm(c[0]); if(ss.fail()) return false;
+				if(!ParseValue(c[0])) return false;
+				c[0] = mm(c[0]);
 				break;
 			case 20:
 				// centre y
 				get_line();
-				ss.str(m_str); ss >> c[1]; c[1] = mm(c[1]); if(ss.fail()) return false;
+				if(!ParseValue(c[1])) return false;
+				c[1] = mm(c[1]);
 				break;
 			case 30:
 				// centre z
 				get_line();
-				ss.str(m_str); ss >> c[2]; c[2] = mm(c[2]); if(ss.fail()) return false;
+				if(!ParseValue(c[2])) return false;
+				c[2] = mm(c[2]);
 				break;
 			case 11:
 				// major x
 				get_line();
-				ss.str(m_str); ss >> m[0]; m[0] = mm(m[0]); if(ss.fail()) return false;
+				if(!ParseValue(m[0])) return false;
+				m[0] = mm(m[0]);
 				break;
 			case 21:
 				// major y
 				get_line();
-				ss.str(m_str); ss >> m[1]; m[1] = mm(m[1]); if(ss.fail()) return false;
+				if(!ParseValue(m[1])) return false;
+				m[1] = mm(m[1]);
 				break;
 			case 31:
 				// major z
 				get_line();
-				ss.str(m_str); ss >> m[2]; m[2] = mm(m[2]); if(ss.fail()) return false;
+				if(!ParseValue(m[2])) return false;
+				m[2] = mm(m[2]);
 				break;
 			case 40:
 				// ratio
 				get_line();
-				ss.str(m_str); ss >> ratio; if(ss.fail()) return false;
+				if(!ParseValue(ratio)) return false;
 				break;
 			case 41:
 				// start
 				get_line();
-				ss.str(m_str); ss >> start; if(ss.fail()) return false;
+				if(!ParseValue(start)) return false;
 				break;
 			case 42:
 				// end
 				get_line();
-				ss.str(m_str); ss >> end; if(ss.fail()) return false;
+				if(!ParseValue(end)) return false;
 				break;
 		        case 62:
 				// color index
 				get_line();
-				ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+				if(!ParseValue(m_aci)) return false;
 				break;
 			case 100:
 			case 210:
@@ -967,17 +1230,15 @@ bool CDxfRead::ReadLwPolyLine()
 	int flags;
 	bool next_item_found = false;
 
-	while(!((*m_ifs).eof()) && !next_item_found)
+	while(!m_eof && !next_item_found)
 	{
 		get_line();
 		int n;
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-			printf("CDxfRead::ReadLwPolyLine() Failed to read integer from '%s'\n", m_str);
+			Report("CDxfRead::ReadLwPolyLine() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
 			return false;
 		}
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:
 				// next item found
@@ -994,7 +1255,7 @@ bool CDxfRead::ReadLwPolyLine()
 				break;
 			case 8: // Layer name follows
 				get_line();
-				strcpy(m_layer_name, m_str);
+				m_layer_name = m_str;
 				break;
 
 			case 10:
@@ -1007,31 +1268,33 @@ bool CDxfRead::ReadLwPolyLine()
 					x_found = false;
 					y_found = false;
 				}
-				ss.str(m_str); ss >> x; x = mm(x); if(ss.fail()) return false;
+				if(!ParseValue(x)) return false;
+				x = mm(x);
 				x_found = true;
 				break;
 			case 20:
 				// y
 				get_line();
-				ss.str(m_str); ss >> y; y = mm(y); if(ss.fail()) return false;
+				if(!ParseValue(y)) return false;
+				y = mm(y);
 				y_found = true;
 				break;
 			case 42:
 				// bulge
 				get_line();
-				ss.str(m_str); ss >> bulge; if(ss.fail()) return false;
+				if(!ParseValue(bulge)) return false;
 				bulge_found = true;
 				break;
 			case 70:
 				// flags
 				get_line();
-				if(sscanf(m_str, "%d", &flags) != 1)return false;
+				if(!ParseValue(flags))return false;
 				closed = ((flags & 1) != 0);
 				break;
 		        case 62:
 				// color index
 				get_line();
-				ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+				if(!ParseValue(m_aci)) return false;
 				break;
 			default:
 				// skip the next line
@@ -1070,15 +1333,13 @@ bool CDxfRead::ReadVertex(double *pVertex, bool *bulge_found, double *bulge)
     pVertex[1] = 0.0;
     pVertex[2] = 0.0;
 
-    while(!(*m_ifs).eof()) {
+    while(!m_eof) {
         get_line();
         int n;
-        if(sscanf(m_str, "%d", &n) != 1) {
-            printf("CDxfRead::ReadVertex() Failed to read integer from '%s'\n", m_str);
+        if(!ParseValue(n)) {
+            Report("CDxfRead::ReadVertex() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
             return false;
         }
-        std::istringstream ss;
-        ss.imbue(std::locale("C"));
         switch(n){
         case 0:
 	    DerefACI();
@@ -1088,36 +1349,39 @@ bool CDxfRead::ReadVertex(double *pVertex, bool *bulge_found, double *bulge)
 
         case 8: // Layer name follows
             get_line();
-            strcpy(m_layer_name, m_str);
+            m_layer_name = m_str;
             break;
 
         case 10:
             // x
             get_line();
-            ss.str(m_str); ss >> x; pVertex[0] = mm(x); if(ss.fail()) return false;
+            if(!ParseValue(x)) return false;
+            pVertex[0] = mm(x);
             x_found = true;
             break;
         case 20:
             // y
             get_line();
-            ss.str(m_str); ss >> y; pVertex[1] = mm(y); if(ss.fail()) return false;
+            if(!ParseValue(y)) return false;
+            pVertex[1] = mm(y);
             y_found = true;
             break;
         case 30:
             // z
             get_line();
-            ss.str(m_str); ss >> z; pVertex[2] = mm(z); if(ss.fail()) return false;
+            if(!ParseValue(z)) return false;
+            pVertex[2] = mm(z);
             break;
 
         case 42:
             get_line();
             *bulge_found = true;
-            ss.str(m_str); ss >> *bulge; if(ss.fail()) return false;
+            if(!ParseValue(*bulge)) return false;
             break;
 	case 62:
 	    // color index
 	    get_line();
-	    ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+	    if(!ParseValue(m_aci)) return false;
 	    break;
 
         default:
@@ -1143,23 +1407,21 @@ bool CDxfRead::ReadPolyLine()
 	bool bulge_found;
 	double bulge;
 
-	while(!(*m_ifs).eof())
+	while(!m_eof)
 	{
 		get_line();
 		int n;
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-		    printf("CDxfRead::ReadPolyLine() Failed to read integer from '%s'\n", m_str);
+		    Report("CDxfRead::ReadPolyLine() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
 		    return false;
 		}
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:
 				// next item found
 			        DerefACI();
 				get_line();
-				if (! strcmp(m_str,"VERTEX"))
+				if (m_str == "VERTEX")
 				{
 				    double vertex[3];
 					if (CDxfRead::ReadVertex(vertex, &bulge_found, &bulge))
@@ -1172,7 +1434,7 @@ bool CDxfRead::ReadPolyLine()
 						break;
 					}
 				}
-				if (! strcmp(m_str,"SEQEND"))
+				if (m_str == "SEQEND")
 				{
                     if(closed && first_vertex_section_found) {
                         AddPolyLinePoint(first_vertex[0], first_vertex[1], first_vertex[2], 0, 0);
@@ -1185,13 +1447,13 @@ bool CDxfRead::ReadPolyLine()
 			case 70:
 				// flags
 				get_line();
-				if(sscanf(m_str, "%d", &flags) != 1)return false;
+				if(!ParseValue(flags))return false;
 				closed = ((flags & 1) != 0);
 				break;
 		        case 62:
 				// color index
 				get_line();
-				ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+				if(!ParseValue(m_aci)) return false;
 				break;
 			default:
 				// skip the next line
@@ -1240,80 +1502,81 @@ void CDxfRead::OnReadEllipse(const double* c, const double* m, double ratio, dou
 
 bool CDxfRead::ReadInsert()
 {
-    double c[3]; // coordinate
+    double c[3] = {0, 0, 0}; // coordinate
     double s[3]; // scale
     double rot = 0.0; // rotation
-    char name[1024];
+    std::string name;
     s[0] = 1.0;
     s[1] = 1.0;
     s[2] = 1.0;
 
-    while(!((*m_ifs).eof()))
+    while(!m_eof)
     {
         get_line();
         int n;
-        if(sscanf(m_str, "%d", &n) != 1)
+        if(!ParseValue(n))
         {
-            printf("CDxfRead::ReadInsert() Failed to read integer from '%s'\n", m_str);
+            Report("CDxfRead::ReadInsert() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
             return false;
         }
-        std::istringstream ss;
-        ss.imbue(std::locale("C"));
         switch(n){
             case 0: 
                 // next item found
                 DerefACI();
-                OnReadInsert(c, s, name, rot * Pi/180);
+                OnReadInsert(c, s, name.c_str(), rot * Pi/180);
                 return(true);
             case 8: 
                 // Layer name follows
                 get_line();
-                strcpy(m_layer_name, m_str);
+                m_layer_name = m_str;
                 break;
             case 10:
                 // coord x
                 get_line();
-                ss.str(m_str); ss >> c[0]; c[0] = mm(c[0]); if(ss.fail()) return false;
+                if(!ParseValue(c[0])) return false;
+                c[0] = mm(c[0]);
                 break;
             case 20:
                 // coord y
                 get_line();
-                ss.str(m_str); ss >> c[1]; c[1] = mm(c[1]); if(ss.fail()) return false;
+                if(!ParseValue(c[1])) return false;
+                c[1] = mm(c[1]);
                 break;
             case 30:
                 // coord z
                 get_line();
-                ss.str(m_str); ss >> c[2]; c[2] = mm(c[2]); if(ss.fail()) return false;
+                if(!ParseValue(c[2])) return false;
+                c[2] = mm(c[2]);
                 break;
             case 41:
                 // scale x
                 get_line();
-                ss.str(m_str); ss >> s[0]; if(ss.fail()) return false;
+                if(!ParseValue(s[0])) return false;
                 break;
             case 42:
                 // scale y
                 get_line();
-                ss.str(m_str); ss >> s[1]; if(ss.fail()) return false;
+                if(!ParseValue(s[1])) return false;
                 break;
             case 43:
                 // scale z
                 get_line();
-                ss.str(m_str); ss >> s[2]; if(ss.fail()) return false;
+                if(!ParseValue(s[2])) return false;
                 break;
             case 50:
                 // rotation
                 get_line();
-                ss.str(m_str); ss >> rot; if(ss.fail()) return false;
+                if(!ParseValue(rot)) return false;
                 break;
             case 2:
                 // block name
                 get_line();
-                strcpy(name, m_str);
+                name = m_str;
                 break;
             case 62:
                 // color index
                 get_line();
-                ss.str(m_str); ss >> m_aci; if(ss.fail()) return false;
+                if(!ParseValue(m_aci)) return false;
                 break;
             case 100:
             case 39:
@@ -1332,39 +1595,289 @@ bool CDxfRead::ReadInsert()
     return false;
 }
 
+bool CDxfRead::ReadBlock()
+{
+	// the BLOCK's name and base point; the entities that make it up come next, up to an ENDBLK
+	double base[3] = {0, 0, 0};
+	std::string name;
+
+	while(!m_eof)
+	{
+		get_line();
+		int n;
+		if(!ParseValue(n))
+		{
+			Report("CDxfRead::ReadBlock() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data());
+			return false;
+		}
+		switch(n){
+			case 0:
+				// next item found
+				m_block_name = name;
+				OnReadBlock(name.c_str(), base);
+				return true;
+			case 2:
+				// block name
+				get_line();
+				name = m_str;
+				break;
+			case 8:
+				// Layer name follows
+				get_line();
+				m_layer_name = m_str;
+				break;
+			case 10:
+				// base point x
+				get_line();
+				if(!ParseValue(base[0])) return false;
+				base[0] = mm(base[0]);
+				break;
+			case 20:
+				// base point y
+				get_line();
+				if(!ParseValue(base[1])) return false;
+				base[1] = mm(base[1]);
+				break;
+			case 30:
+				// base point z
+				get_line();
+				if(!ParseValue(base[2])) return false;
+				base[2] = mm(base[2]);
+				break;
+			default:
+				// skip the next line
+				get_line();
+				break;
+		}
+	}
+	return false;
+}
+
+bool CDxfRead::ReadEndBlock()
+{
+	while(!m_eof)
+	{
+		get_line();
+		if(m_str == "0")
+		{
+			// next item found
+			m_block_name.clear();
+			OnReadEndBlock();
+			return true;
+		}
+		// skip the next line
+		get_line();
+	}
+	return false;
+}
+
+// the line starting at pos, without leading spaces and tabs or a trailing '\r'; pos is moved to the start of the next line
+static std::string_view NextLine(const char* data, size_t& pos, size_t end)
+{
+	size_t start = pos;
+	size_t line_end = end;
+	const char* nl = static_cast<const char*>(memchr(data + pos, '\n', end - pos));
+	if(nl){
+		line_end = nl - data;
+		pos = line_end + 1;
+	}
+	else{
+		pos = end;
+	}
+
+	while(start < line_end && (data[start] == ' ' || data[start] == '\t'))start++;
+	if(line_end > start && data[line_end - 1] == '\r')line_end--;
+	return std::string_view(data + start, line_end - start);
+}
+
+// the line before the one starting at pos, which mustn't be 0
+static size_t PrevLineStart(const char* data, size_t pos)
+{
+	pos--; // the previous line's newline
+	while(pos > 0 && data[pos - 1] != '\n')pos--;
+	return pos;
+}
+
 void CDxfRead::get_line()
 {
-    if (m_unused_line[0] != '\0')
-    {
-        strcpy(m_str, m_unused_line);
-        memset( m_unused_line, '\0', sizeof(m_unused_line));
-        return;
-    }
+	// the next line, without leading spaces and tabs or a trailing '\r'.
+	// m_str points into the file's memory; nothing is copied
+	if (m_line_unused)
+	{
+		m_str = m_unused_line;
+		m_line_unused = false;
+		return;
+	}
 
-	m_ifs->getline(m_str, 1024);
+	const char* data = m_file->Data();
+	if(m_pos >= m_end){
+		m_str = std::string_view();
+		m_is_number = false;
+		m_eof = true;
+		return;
+	}
 
-	char str[1024];
-	size_t len = strlen(m_str);
-	int j = 0;
-	bool non_white_found = false;
-	for(int i = 0; i<len; i++){
-		if(non_white_found || (m_str[i] != ' ' && m_str[i] != '\t')){
-#if wxUSE_UNICODE
-			if(m_str[i] != '\r')
-#endif
+	if(m_binary){
+		get_binary_line();
+		return;
+	}
+
+	m_str = NextLine(data, m_pos, m_end);
+
+	// a last line without a newline; eof is set now, as ifstream::getline would
+	if(m_pos == m_end && data[m_end - 1] != '\n')m_eof = true;
+}
+
+// a little endian number of the given number of bytes, at data
+static uint64_t LittleEndian(const unsigned char* data, int bytes)
+{
+	uint64_t value = 0;
+	for(int i = bytes - 1; i >= 0; i--)value = (value << 8) | data[i];
+	return value;
+}
+
+void CDxfRead::get_binary_line()
+{
+	// the group codes and values of a binary DXF, one at a time, as get_line gives the lines of a text one.
+	// strings point into the file; numbers go in m_number, and group codes and integers are also made into text,
+	// so that the "0" lines are found as they are in a text file
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(m_file->Data());
+	size_t left = m_end - m_pos;
+	m_is_number = false;
+
+	if(m_binary_code < 0)
+	{
+		// a group code; two bytes, or in older files one, with 255 saying that two follow
+		int code;
+		size_t bytes = m_binary_short_codes ? 1 : 2;
+		if(left >= bytes)
+		{
+			code = static_cast<int>(LittleEndian(data + m_pos, static_cast<int>(bytes)));
+			if(m_binary_short_codes && code == 255)
 			{
-				str[j] = m_str[i]; j++;
+				bytes = 3;
+				if(left >= bytes)code = static_cast<int>(LittleEndian(data + m_pos + 1, 2));
 			}
-			non_white_found = true;
 		}
+		if(left < bytes)
+		{
+			m_str = std::string_view();
+			m_pos = m_end;
+			m_eof = true;
+			return;
+		}
+		m_pos += bytes;
+		m_binary_code = code;
+		m_is_number = true;
+		m_number = code;
+		m_str = std::string_view(m_number_text, std::to_chars(m_number_text, m_number_text + sizeof(m_number_text), code).ptr - m_number_text);
+		return;
+	}
+
+	BinaryType type = GetBinaryType(m_binary_code);
+	m_binary_code = -1;
+	if(type == eBinaryString)
+	{
+		const char* start = m_file->Data() + m_pos;
+		const char* end = static_cast<const char*>(memchr(start, 0, left));
+		if(end == nullptr)
+		{
+			// a last string without its 0
+			m_str = std::string_view(start, left);
+			m_pos = m_end;
+			m_eof = true;
+			return;
+		}
+		m_str = std::string_view(start, end - start);
+		m_pos += m_str.size() + 1;
+		return;
 	}
-	str[j] = 0;
-	strcpy(m_str, str);
+
+	if(type == eBinaryChunk)
+	{
+		// binary data isn't used, so it is skipped
+		size_t bytes = (left > 0) ? 1 + data[m_pos] : 1;
+		m_str = std::string_view();
+		if(left < bytes)
+		{
+			m_pos = m_end;
+			m_eof = true;
+			return;
+		}
+		m_pos += bytes;
+		return;
+	}
+
+	int bytes = 8;
+	if(type == eBinaryInt16)bytes = 2;
+	else if(type == eBinaryInt32)bytes = 4;
+	else if(type == eBinaryBool)bytes = 1;
+	if(left < static_cast<size_t>(bytes))
+	{
+		m_str = std::string_view();
+		m_pos = m_end;
+		m_eof = true;
+		return;
+	}
+	uint64_t bits = LittleEndian(data + m_pos, bytes);
+	m_pos += bytes;
+	m_is_number = true;
+
+	if(type == eBinaryDouble)
+	{
+		// not made into text; no lines of a text file that are doubles are looked at as text
+		memcpy(&m_number, &bits, sizeof(m_number));
+		m_str = std::string_view();
+		return;
+	}
+
+	long long value;
+	if(type == eBinaryInt16)value = static_cast<int16_t>(bits);
+	else if(type == eBinaryInt32)value = static_cast<int32_t>(bits);
+	else if(type == eBinaryInt64)value = static_cast<long long>(bits);
+	else value = static_cast<long long>(bits); // bool
+	m_number = static_cast<double>(value);
+	m_str = std::string_view(m_number_text, std::to_chars(m_number_text, m_number_text + sizeof(m_number_text), value).ptr - m_number_text);
+}
+
+void CDxfRead::put_line(std::string_view value)
+{
+	m_unused_line = value;
+	m_line_unused = true;
+}
+
+bool CDxfRead::ParseValue(double& value)const
+{
+	// as istream >> double did in the C locale; the number must start the line, anything after it is ignored
+	if(m_is_number){
+		value = m_number;
+		return true;
+	}
+	const char* first = m_str.data();
+	const char* last = first + m_str.size();
+	if(first != last && *first == '+')first++;	// from_chars doesn't take a '+'
+#ifdef __cpp_lib_to_chars
+	return std::from_chars(first, last, value).ec == std::errc();
+#else
+	std::istringstream ss(std::string(first, last));
+	ss.imbue(std::locale("C"));
+	ss >> value;
+	return !ss.fail();
+#endif
 }
 
-void CDxfRead::put_line(const char *value)
+bool CDxfRead::ParseValue(int& value)const
 {
-	strcpy( m_unused_line, value );
+	if(m_is_number){
+		// a double is cut down to an integer, as parsing its text would
+		if(!(m_number > std::numeric_limits<int>::min() - 1.0 && m_number < std::numeric_limits<int>::max() + 1.0))return false;
+		value = static_cast<int>(m_number);
+		return true;
+	}
+	const char* first = m_str.data();
+	const char* last = first + m_str.size();
+	if(first != last && *first == '+')first++;
+	return std::from_chars(first, last, value).ec == std::errc();
 }
 
 
@@ -1373,14 +1886,14 @@ bool CDxfRead::ReadUnits()
 	get_line();	// Skip to next line.
 	get_line();	// Skip to next line.
 	int n = 0;
-	if(sscanf(m_str, "%d", &n) == 1)
+	if(ParseValue(n))
 	{
 		m_eUnits = eDxfUnits_t( n );
 		return(true);
 	} // End if - then
 	else
 	{
-	    printf("CDxfRead::ReadUnits() Failed to get integer from '%s'\n", m_str);
+	    Report("CDxfRead::ReadUnits() Failed to get integer from '%.*s'\n", (int)m_str.size(), m_str.data());
 		return(false);
 	}
 }
@@ -1391,24 +1904,22 @@ bool CDxfRead::ReadLayer()
         std::string layername;
 	int aci = -1;
 
-	while(!((*m_ifs).eof()))
+	while(!m_eof)
 	{
 		get_line();
 		int n;
 
-		if(sscanf(m_str, "%d", &n) != 1)
+		if(!ParseValue(n))
 		{
-		    printf("CDxfRead::ReadLayer() Failed to read integer from '%s'\n", m_str );
+		    Report("CDxfRead::ReadLayer() Failed to read integer from '%.*s'\n", (int)m_str.size(), m_str.data() );
 		    return false;
 		}
 
-		std::istringstream ss;
-		ss.imbue(std::locale("C"));
 		switch(n){
 			case 0:	// next item found, so finish with line
 			        if (layername.empty())
 				{
-				    printf("CDxfRead::ReadLayer() - no layer name\n");
+				    Report("CDxfRead::ReadLayer() - no layer name\n");
 				    return false;
 				}
 			        m_layer_aci[layername] = aci;
@@ -1422,7 +1933,7 @@ bool CDxfRead::ReadLayer()
 			case 62:
 				// layer color ; if negative, layer is off
 				get_line();
-				if(sscanf(m_str, "%d", &aci) != 1)return false;
+				if(!ParseValue(aci))return false;
 				break;
 
 			case 6:	// linetype name
@@ -1443,6 +1954,79 @@ bool CDxfRead::ReadLayer()
 	return false;
 }
 
+// the names DoRead looks for
+enum DxfName
+{
+	eDxfOtherName = 0,
+	eDxfZero,
+	eDxfInsUnits,
+	eDxfBlockBegin,
+	eDxfSection,
+	eDxfTable,
+	eDxfLayer,
+	eDxfEndSec,
+	eDxfBlock,
+	eDxfEndBlk,
+	eDxfLine,
+	eDxfArc,
+	eDxfCircle,
+	eDxfMText,
+	eDxfEllipse,
+	eDxfSpline,
+	eDxfLwPolyLine,
+	eDxfPolyLine,
+	eDxfPoint,
+	eDxfInsert
+};
+
+static DxfName GetDxfName(std::string_view name)
+{
+	// switch on the length, so that a name is compared with one or two others, not with all of them
+	switch(name.size())
+	{
+		case 1:
+			if(name[0] == '0')return eDxfZero;
+			break;
+		case 3:
+			if(name == "ARC")return eDxfArc;
+			break;
+		case 4:
+			if(name == "LINE")return eDxfLine;
+			break;
+		case 5:
+			if(name == "POINT")return eDxfPoint;
+			if(name == "LAYER")return eDxfLayer;
+			if(name == "TABLE")return eDxfTable;
+			if(name == "MTEXT")return eDxfMText;
+			if(name == "BLOCK")return eDxfBlock;
+			break;
+		case 6:
+			if(name == "CIRCLE")return eDxfCircle;
+			if(name == "ENDSEC")return eDxfEndSec;
+			if(name == "INSERT")return eDxfInsert;
+			if(name == "SPLINE")return eDxfSpline;
+			if(name == "ENDBLK")return eDxfEndBlk;
+			break;
+		case 7:
+			if(name == "ELLIPSE")return eDxfEllipse;
+			if(name == "SECTION")return eDxfSection;
+			break;
+		case 8:
+			if(name == "POLYLINE")return eDxfPolyLine;
+			break;
+		case 9:
+			if(name == "$INSUNITS")return eDxfInsUnits;
+			break;
+		case 10:
+			if(name == "LWPOLYLINE")return eDxfLwPolyLine;
+			break;
+		case 14:
+			if(name == "AcDbBlockBegin")return eDxfBlockBegin;
+			break;
+	}
+	return eDxfOtherName;
+}
+
 void CDxfRead::DoRead(const bool ignore_errors /* = false */ )
 {
 	m_ignore_errors = ignore_errors;
@@ -1450,165 +2034,762 @@ void CDxfRead::DoRead(const bool ignore_errors /* = false */ )
 
 	get_line();
 
-	while(!((*m_ifs).eof()))
+	if(ReadItems())AddGraphics();
+}
+
+bool CDxfRead::ReadItems()
+{
+	// reads to the end of the file, or of the chunk; false on an item that can't be read
+	while(!m_eof)
 	{
-		if (!strcmp( m_str, "$INSUNITS" )){
-			if (!ReadUnits())return;
+		switch(GetDxfName(m_str))
+		{
+		case eDxfInsUnits:
+			if (!ReadUnits())return false;
 			continue;
-		} // End if - then
 
-		else if (!strcmp( m_str, "AcDbBlockBegin" )){
+		case eDxfBlockBegin:
 			get_line();
 
-			if (! strcmp(m_str,"2"))
+			if (m_str == "2")
 			{
 			    get_line();
-			    strcpy(m_block_name, m_str);
+			    m_block_name = m_str;
 			}
-		} // End if - then
-		else if(!strcmp(m_str, "0"))
+			break;
+
+		case eDxfZero:
 		{
 			get_line();
-			if (!strcmp( m_str, "SECTION" )){
-			  get_line();
-			  get_line();
-			  strcpy(m_section_name, m_str);
-			  strcpy(m_block_name, "");
-
-		} // End if - then
-		else if (!strcmp( m_str, "TABLE" )){
-			  get_line();
-			  get_line();
-		}
+			DxfName name = GetDxfName(m_str);
+			if(name >= eDxfLine && SkipEntity(name == eDxfPolyLine))continue; // the names from eDxfLine on are entities
+			switch(name)
+			{
+			case eDxfSection:
+				get_line();
+				get_line();
+				m_section_name = m_str;
+				m_block_name.clear();
+				if(m_entities_only && m_section_name != "HEADER" && m_section_name != "TABLES" && m_section_name != "ENTITIES")
+				{
+					SkipSection();
+					continue; // at the "0" before ENDSEC
+				}
+				if(m_section_name == "ENTITIES" && !m_in_chunk)
+				{
+					std::vector<size_t> starts;
+					if(SplitEntities(starts))
+					{
+						if(!ReadChunks(starts))return false;
+						continue; // at the "0" before ENDSEC
+					}
+				}
+				break;
 
-		else if (!strcmp( m_str, "LAYER" )){
-			  get_line();
-			  get_line();
-			  if(!ReadLayer())
-			    {
-			      printf("CDxfRead::DoRead() Failed to read layer\n");
-			      return;
-			    }
-			  continue;		}
-
-		else if (!strcmp( m_str, "ENDSEC" )){
-                    strcpy(m_section_name, "");
-                    strcpy(m_block_name, "");
-                } // End if - then
-		else if(!strcmp(m_str, "LINE")){
+			case eDxfTable:
+				get_line();
+				get_line();
+				break;
+
+			case eDxfLayer:
+				get_line();
+				get_line();
+				if(!ReadLayer())
+				{
+					Report("CDxfRead::DoRead() Failed to read layer\n");
+					return false;
+				}
+				continue;
+
+			case eDxfEndSec:
+				m_section_name.clear();
+				m_block_name.clear();
+				break;
+
+			case eDxfBlock:
+				if(!ReadBlock())
+				{
+				    Report("CDxfRead::DoRead() Failed to read block\n");
+				    return false;
+				}
+				continue;
+
+			case eDxfEndBlk:
+				if(!ReadEndBlock())
+				{
+				    Report("CDxfRead::DoRead() Failed to read end of block\n");
+				    return false;
+				}
+				continue;
+
+			case eDxfLine:
 				if(!ReadLine())
 				{
-				    printf("CDxfRead::DoRead() Failed to read line\n");
-				    return;
+				    Report("CDxfRead::DoRead() Failed to read line\n");
+				    return false;
 				}
 				continue;
-			}
-			else if(!strcmp(m_str, "ARC")){
+
+			case eDxfArc:
 				if(!ReadArc())
 				{
-				    printf("CDxfRead::DoRead() Failed to read arc\n");
-				    return;
+				    Report("CDxfRead::DoRead() Failed to read arc\n");
+				    return false;
 				}
 				continue;
-			}
-			else if(!strcmp(m_str, "CIRCLE")){
+
+			case eDxfCircle:
 				if(!ReadCircle())
 				{
-				    printf("CDxfRead::DoRead() Failed to read circle\n");
-				    return;
+				    Report("CDxfRead::DoRead() Failed to read circle\n");
+				    return false;
 				}
 				continue;
-			}
-			else if(!strcmp(m_str, "MTEXT")){
+
+			case eDxfMText:
 				if(!ReadText())
 				{
-				    printf("CDxfRead::DoRead() Failed to read text\n");
-				    return;
+				    Report("CDxfRead::DoRead() Failed to read text\n");
+				    return false;
 				}
 				continue;
-			}
-			else if(!strcmp(m_str, "ELLIPSE")){
+
+			case eDxfEllipse:
 				if(!ReadEllipse())
 				{
-				    printf("CDxfRead::DoRead() Failed to read ellipse\n");
-				    return;
+				    Report("CDxfRead::DoRead() Failed to read ellipse\n");
+				    return false;
 				}
 				continue;
-			}
-			else if(!strcmp(m_str, "SPLINE")){
+
+			case eDxfSpline:
 				if(!ReadSpline())
 				{
-				    printf("CDxfRead::DoRead() Failed to read spline\n");
-				    return;
+				    Report("CDxfRead::DoRead() Failed to read spline\n");
+				    return false;
 				}
 				continue;
-			}
-			else if (!strcmp(m_str, "LWPOLYLINE")) {
+
+			case eDxfLwPolyLine:
 				if(!ReadLwPolyLine())
 				{
-				    printf("CDxfRead::DoRead() Failed to read LW Polyline\n");
-				    return;
+				    Report("CDxfRead::DoRead() Failed to read LW Polyline\n");
+				    return false;
 				}
 				continue;
-			}
-			else if (!strcmp(m_str, "POLYLINE")) {
+
+			case eDxfPolyLine:
 				if(!ReadPolyLine())
 				{
-				    printf("CDxfRead::DoRead() Failed to read Polyline\n");
-				    return;
+				    Report("CDxfRead::DoRead() Failed to read Polyline\n");
+				    return false;
 				}
 				continue;
-			}
-			else if (!strcmp(m_str, "POINT")) {
+
+			case eDxfPoint:
 				if(!ReadPoint())
 				{
-				    printf("CDxfRead::DoRead() Failed to read Point\n");
-				    return;
+				    Report("CDxfRead::DoRead() Failed to read Point\n");
+				    return false;
+				}
+				continue;
+
+			case eDxfInsert:
+				if(!ReadInsert())
+				{
+				    Report("CDxfRead::DoRead() Failed to read Insert\n");
+				    return false;
 				}
 				continue;
+
+			default:
+				break;
 			}
-            else if (!strcmp(m_str, "INSERT")) {
-                if(!ReadInsert())
-                {
-                    printf("CDxfRead::DoRead() Failed to read Insert\n");
-                    return;
-                }
-                continue;
-            }
+			break;
 		}
 
+		default:
+			break;
+		}
+
+		get_line();
+	}
+
+	return true;
+}
+
+void CDxfRead::SetLayerFilter(const std::vector<std::string>& layers)
+{
+	m_layer_filter.clear();
+	m_layer_filter.insert(layers.begin(), layers.end());
+}
+
+bool CDxfRead::SkipEntity(bool polyline)
+{
+	// with a layer filter, an entity on another layer is stepped over a group at a time, without its values being parsed;
+	// true if it was, leaving its last line as the current one, as reading it would have.
+	// its layer and colour are kept, as reading it would have done, for the next entities that don't give theirs
+	if(m_layer_filter.empty() || m_line_unused)return false;
+	if(polyline)return SkipPolyLine();
+
+	size_t pos = m_pos;
+	int binary_code = m_binary_code;
+	bool eof = m_eof;
+	std::string_view str = m_str;
+
+	std::string_view layer;
+	bool layer_found = false;
+	Aci_t aci = m_aci;
+	bool aci_found = false;
+	while(!m_eof)
+	{
+		get_line();
+		if(m_str == "0")break;
+		bool is_layer = (m_str == "8");
+		bool is_aci = (m_str == "62");
+		get_line();
+		if(is_layer)
+		{
+			layer = m_str;
+			layer_found = true;
+			if(m_layer_filter.count(layer))break;
+		}
+		else if(is_aci)
+		{
+			aci_found = ParseValue(aci);
+		}
+	}
+
+	bool wanted;
+	if(layer_found)
+	{
+		wanted = (m_layer_filter.count(layer) != 0);
+	}
+	else if(m_layer_name == UnknownLayer)
+	{
+		// in a chunk, on the layer from before it
+		m_reread = true;
+		wanted = false;
+	}
+	else
+	{
+		wanted = (m_layer_filter.count(m_layer_name) != 0);
+	}
+
+	if(wanted)
+	{
+		// back to the start, to read it
+		m_pos = pos;
+		m_binary_code = binary_code;
+		m_eof = eof;
+		m_str = str;
+		m_is_number = false;
+		return false;
+	}
+
+	if(layer_found)m_layer_name = layer;
+	if(aci_found)m_aci = aci;
+	DerefACI();
+	return true;
+}
+
+bool CDxfRead::SkipPolyLine()
+{
+	// ReadPolyLine takes the layer from each VERTEX, not from the POLYLINE, so it is wanted if any of its vertices are.
+	// the layer and colour are followed through to the SEQEND, as ReadPolyLine and ReadVertex would
+	size_t pos = m_pos;
+	int binary_code = m_binary_code;
+	bool eof = m_eof;
+	std::string_view str = m_str;
+	std::string layer_name = m_layer_name;
+	Aci_t aci = m_aci;
+
+	bool in_vertex = false;
+	bool wanted = false;
+	while(!m_eof)
+	{
+		get_line();
+		if(m_str == "0")
+		{
+			DerefACI();
+			if(in_vertex)
+			{
+				if(m_layer_name == UnknownLayer)m_reread = true; // in a chunk, on the layer from before it
+				else if(m_layer_filter.count(m_layer_name))
+				{
+					wanted = true;
+					break;
+				}
+			}
+			get_line();
+			if(m_str == "SEQEND")break;
+			in_vertex = (m_str == "VERTEX");
+			continue;
+		}
+		bool is_layer = in_vertex && (m_str == "8");
+		bool is_aci = (m_str == "62");
+		get_line();
+		if(is_layer)m_layer_name = m_str;
+		else if(is_aci)ParseValue(m_aci);
+	}
+
+	if(wanted)
+	{
+		// back to the start, to read it
+		m_pos = pos;
+		m_binary_code = binary_code;
+		m_eof = eof;
+		m_str = str;
+		m_is_number = false;
+		m_layer_name = layer_name;
+		m_aci = aci;
+		return false;
+	}
+
+	return true;
+}
+
+void CDxfRead::SkipSection()
+{
+	// steps over the rest of the section, to the "0" before its ENDSEC, leaving that as the current line.
+	// in a text file, ENDSEC on a line after a "0" can only be the end of a section, as a group code is a number,
+	// so it is searched for; a binary file is stepped through a group at a time
+	const char* data = m_file->Data();
+	if(m_binary || m_line_unused)
+	{
+		while(!m_eof)
+		{
+			size_t code_pos = m_pos;
+			get_line();
+			bool zero = (m_str == "0");
+			get_line();
+			if(zero && m_str == "ENDSEC" && !m_line_unused)
+			{
+				m_pos = code_pos;
+				m_binary_code = -1;
+				m_eof = false;
+				get_line();
+				return;
+			}
+		}
+		return;
+	}
+
+	std::string_view file(data, m_end);
+	for(size_t k = file.find("ENDSEC", m_pos); k != std::string_view::npos; k = file.find("ENDSEC", k + 1))
+	{
+		size_t line = k;
+		while(line > m_pos && (data[line - 1] == ' ' || data[line - 1] == '\t'))line--;
+		if(line <= m_pos || data[line - 1] != '\n')continue;
+		size_t p = line;
+		if(NextLine(data, p, m_end) != "ENDSEC")continue;
+		size_t zero = PrevLineStart(data, line);
+		p = zero;
+		if(zero < m_pos || NextLine(data, p, m_end) != "0")continue;
+		m_pos = zero;
+		m_eof = false;
 		get_line();
+		return;
+	}
+
+	m_pos = m_end;
+	m_str = std::string_view();
+	m_eof = true;
+}
+
+
+// reads part of an ENTITIES section on another thread, keeping what it finds for CDxfRead::ReadChunks to pass on in order
+class CDxfChunkRead : public CDxfRead
+{
+public:
+	struct Item
+	{
+		enum Type{eLine, ePoint, eText, eArc, eCircle, eEllipse, eSpline, eInsert};
+		Type type;
+		int layer; // in m_layers, or -1 for the layer from before the chunk
+		Aci_t aci;
+		bool dir;
+		int index; // of the text or insert name in m_strings, or of the spline in m_splines
+		double v[9];
+	};
+
+	size_t m_begin;
+	size_t m_chunk_end;
+	std::vector<Item> m_items;
+	std::vector<std::string> m_layers;
+	std::vector<std::string> m_strings;
+	std::vector<SplineData> m_splines;
+
+	CDxfChunkRead(const CDxfRead& reader, size_t begin, size_t end):CDxfRead(reader, begin, end), m_begin(begin), m_chunk_end(end){}
+
+	void Read()
+	{
+		try
+		{
+			get_line();
+			if(!ReadItems())m_reread = true;
+		}
+		catch(...)
+		{
+			m_reread = true;
+		}
+	}
+
+	void OnReadLine(const double* s, const double* e) override
+	{
+		double v[6] = {s[0], s[1], s[2], e[0], e[1], e[2]};
+		Add(Item::eLine, v, 6);
+	}
+	void OnReadPoint(const double* s) override
+	{
+		Add(Item::ePoint, s, 3);
+	}
+	void OnReadText(const double* point, const double height, const char* text) override
+	{
+		double v[4] = {point[0], point[1], point[2], height};
+		Add(Item::eText, v, 4).index = static_cast<int>(m_strings.size());
+		m_strings.push_back(text);
+	}
+	void OnReadArc(const double* s, const double* e, const double* c, bool dir) override
+	{
+		double v[9] = {s[0], s[1], s[2], e[0], e[1], e[2], c[0], c[1], c[2]};
+		Add(Item::eArc, v, 9).dir = dir;
+	}
+	void OnReadCircle(const double* s, const double* c, bool dir) override
+	{
+		double v[6] = {s[0], s[1], s[2], c[0], c[1], c[2]};
+		Add(Item::eCircle, v, 6).dir = dir;
+	}
+	void OnReadEllipse(const double* c, double major_radius, double minor_radius, double rotation, double start_angle, double end_angle, bool dir) override
+	{
+		double v[8] = {c[0], c[1], c[2], major_radius, minor_radius, rotation, start_angle, end_angle};
+		Add(Item::eEllipse, v, 8).dir = dir;
+	}
+	void OnReadSpline(struct SplineData& sd) override
+	{
+		Add(Item::eSpline, nullptr, 0).index = static_cast<int>(m_splines.size());
+		m_splines.push_back(std::move(sd)); // ReadSpline is done with it
+	}
+	void OnReadInsert(const double* point, const double* scale, const char* name, double rotation) override
+	{
+		double v[7] = {point[0], point[1], point[2], scale[0], scale[1], scale[2], rotation};
+		Add(Item::eInsert, v, 7).index = static_cast<int>(m_strings.size());
+		m_strings.push_back(name);
+	}
+
+private:
+	Item& Add(Item::Type type, const double* v, int n)
+	{
+		Item item;
+		item.type = type;
+		if(m_layer_name == UnknownLayer)item.layer = -1;
+		else
+		{
+			if(m_layers.empty() || m_layers.back() != m_layer_name)m_layers.push_back(m_layer_name);
+			item.layer = static_cast<int>(m_layers.size()) - 1;
+		}
+		item.aci = m_aci;
+		item.dir = false;
+		item.index = 0;
+		for(int i = 0; i < n; i++)item.v[i] = v[i];
+		m_items.push_back(item);
+		return m_items.back();
+	}
+};
+
+// the name after a "0" line at pos, empty if pos isn't a "0" followed by something that can't be a group code
+static std::string_view EntityName(const char* data, size_t pos, size_t end)
+{
+	if(NextLine(data, pos, end) != "0")return std::string_view();
+	std::string_view name = NextLine(data, pos, end);
+	int code;
+	if(std::from_chars(name.data(), name.data() + name.size(), code).ec == std::errc())return std::string_view();
+	return name;
+}
+
+// true if the "0" line at pos is the start of an entity that DoRead would find, reading the whole file.
+// DoRead steps through entities it doesn't know a line at a time, so it skips a "0" after a value of 0,
+// unless the entity before is one that is read in pairs
+static bool StartsEntity(const char* data, size_t pos, size_t end, std::string_view& name, int depth = 64)
+{
+	if(pos < 2)return false;
+	name = EntityName(data, pos, end);
+	if(name.empty())return false;
+	if(name == "VERTEX" || name == "SEQEND")return false; // part of a POLYLINE
+
+	size_t p1 = PrevLineStart(data, pos);
+	size_t p = p1;
+	std::string_view line1 = NextLine(data, p, end);
+	if(line1 == "$INSUNITS" || line1 == "AcDbBlockBegin")return false;
+	if(p1 > 0)
+	{
+		p = PrevLineStart(data, p1);
+		if(NextLine(data, p, end) == "AcDbBlockBegin")return false;
 	}
 
-    AddGraphics();
+	if(line1 == "0")
+	{
+		if(depth == 0)return false;
+		size_t prev = p1;
+		for(int i = 0; i < 1000 && prev > 0; i++)
+		{
+			prev = PrevLineStart(data, prev);
+			std::string_view prev_name;
+			if(EntityName(data, prev, end).empty())continue;
+			if(!StartsEntity(data, prev, end, prev_name, depth - 1))return false;
+			return prev_name == "LINE" || prev_name == "ARC" || prev_name == "CIRCLE" || prev_name == "POINT" || prev_name == "ELLIPSE" ||
+				prev_name == "SPLINE" || prev_name == "MTEXT" || prev_name == "LWPOLYLINE" || prev_name == "INSERT";
+		}
+		return false;
+	}
+	return true;
 }
 
+bool CDxfRead::SplitEntities(std::vector<size_t>& starts)const
+{
+	// the ENTITIES section starts at m_pos. starts gets where to split it, at the "0" lines of entities,
+	// then the "0" before ENDSEC. false if it isn't worth splitting
+	unsigned int num_threads = m_read_threads ? m_read_threads : std::thread::hardware_concurrency();
+	if(num_threads < 2 || m_line_unused || m_binary)return false;
+
+	const char* data = m_file->Data();
+	std::string_view file(data, m_end);
+	std::string_view name;
+	size_t section_end = m_end;
+	for(size_t k = file.find("ENDSEC", m_pos); k != std::string_view::npos; k = file.find("ENDSEC", k + 1))
+	{
+		size_t line = k;
+		while(line > 0 && (data[line - 1] == ' ' || data[line - 1] == '\t'))line--;
+		if(line == 0 || data[line - 1] != '\n')continue;
+		size_t zero = PrevLineStart(data, line);
+		if(EntityName(data, zero, m_end) != "ENDSEC")continue;
+		if(!StartsEntity(data, zero, m_end, name))return false; // DoRead might not see it
+		section_end = zero;
+		break;
+	}
+	if(section_end == m_end || section_end - m_pos < MinBytesForThreads)return false;
+
+	size_t chunk_bytes = std::min(MaxChunkBytes, std::max(MinChunkBytes, (section_end - m_pos) / (num_threads * 4)));
+	starts.push_back(m_pos);
+	for(size_t pos = m_pos + chunk_bytes; pos < section_end; pos += chunk_bytes)
+	{
+		// the next entity from pos
+		if(data[pos - 1] != '\n')NextLine(data, pos, section_end);
+		while(pos < section_end && !StartsEntity(data, pos, section_end, name))NextLine(data, pos, section_end);
+		if(pos >= section_end)break;
+		starts.push_back(pos);
+	}
+	starts.push_back(section_end);
+	return starts.size() > 2;
+}
+
+bool CDxfRead::ReadChunks(const std::vector<size_t>& starts)
+{
+	// the chunks are read on other threads, a few ahead of the one whose items are being passed on here
+	const char* data = m_file->Data();
+	size_t num_chunks = starts.size() - 1;
+	std::vector<std::unique_ptr<CDxfChunkRead>> chunks;
+	for(size_t i = 0; i < num_chunks; i++)
+	{
+		// each chunk ends with the "0" of the next entity, which finishes its last one
+		size_t end = starts[i + 1];
+		NextLine(data, end, m_end);
+		chunks.push_back(std::make_unique<CDxfChunkRead>(*this, starts[i], end));
+		if(i > 0)
+		{
+			chunks.back()->m_layer_name = UnknownLayer;
+			chunks.back()->m_aci = UnknownAci;
+		}
+	}
+
+	unsigned int num_threads = m_read_threads ? m_read_threads : std::thread::hardware_concurrency();
+	size_t max_ahead = 2 * num_threads;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<char> read(num_chunks, 0);
+	size_t next_chunk = 0;
+	size_t num_passed = 0;
+	bool stop = false;
+
+	auto read_chunks = [&]()
+	{
+		for(;;)
+		{
+			size_t i;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&]{return stop || next_chunk == num_chunks || next_chunk < num_passed + max_ahead;});
+				if(stop || next_chunk == num_chunks)return;
+				i = next_chunk++;
+			}
+			chunks[i]->Read();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				read[i] = 1;
+			}
+			cv.notify_all();
+		}
+	};
+
+	// this thread passes the items on, so the others read
+	std::vector<std::thread> threads;
+	size_t num_readers = std::min<size_t>(std::max(1u, num_threads - 1), num_chunks);
+	for(size_t t = 0; t < num_readers; t++)threads.emplace_back(read_chunks);
+	auto stop_threads = [&]()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+		for(auto &thread : threads)thread.join();
+	};
+
+	bool ok = true;
+	try
+	{
+		for(size_t i = 0; i < num_chunks && ok; i++)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&]{return read[i] != 0;});
+			}
+			ok = ReplayChunk(*chunks[i]);
+			chunks[i].reset();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				num_passed = i + 1;
+			}
+			cv.notify_all();
+		}
+	}
+	catch(...)
+	{
+		stop_threads();
+		throw;
+	}
+	stop_threads();
+	if(!ok)return false;
+
+	m_pos = starts.back();
+	m_eof = false;
+	m_line_unused = false;
+	get_line();
+	return true;
+}
+
+bool CDxfRead::ReplayChunk(CDxfChunkRead& chunk)
+{
+	// calls the On... functions for the chunk's items, with the layer and colour they would have had, reading the whole file here
+	if(chunk.m_reread || (chunk.m_needs_start_aci && m_aci == 256))
+	{
+		// read it again, now that the layer and colour before it are known
+		m_pos = chunk.m_begin;
+		m_end = chunk.m_chunk_end;
+		m_eof = false;
+		m_line_unused = false;
+		get_line();
+		bool ok = ReadItems();
+		m_end = m_file->Size();
+		m_eof = false;
+		return ok;
+	}
+
+	std::string start_layer = m_layer_name;
+	Aci_t start_aci = m_aci;
+	int layer = -2;
+	for(const auto &item : chunk.m_items)
+	{
+		if(item.layer != layer)
+		{
+			layer = item.layer;
+			m_layer_name = (layer < 0) ? start_layer : chunk.m_layers[layer];
+		}
+		m_aci = (item.aci == UnknownAci) ? start_aci : item.aci;
+		const double* v = item.v;
+		switch(item.type)
+		{
+		case CDxfChunkRead::Item::eLine:
+			OnReadLine(v, v + 3);
+			break;
+		case CDxfChunkRead::Item::ePoint:
+			OnReadPoint(v);
+			break;
+		case CDxfChunkRead::Item::eText:
+			OnReadText(v, v[3], chunk.m_strings[item.index].c_str());
+			break;
+		case CDxfChunkRead::Item::eArc:
+			OnReadArc(v, v + 3, v + 6, item.dir);
+			break;
+		case CDxfChunkRead::Item::eCircle:
+			OnReadCircle(v, v + 3, item.dir);
+			break;
+		case CDxfChunkRead::Item::eEllipse:
+			OnReadEllipse(v, v[3], v[4], v[5], v[6], v[7], item.dir);
+			break;
+		case CDxfChunkRead::Item::eSpline:
+			OnReadSpline(chunk.m_splines[item.index]);
+			break;
+		case CDxfChunkRead::Item::eInsert:
+			OnReadInsert(v, v + 3, chunk.m_strings[item.index].c_str(), v[6]);
+			break;
+		}
+	}
+
+	// what the next chunk starts with
+	m_layer_name = (chunk.m_layer_name == UnknownLayer) ? start_layer : chunk.m_layer_name;
+	m_aci = (chunk.m_aci == UnknownAci) ? start_aci : chunk.m_aci;
+	return true;
+}
 
 void  CDxfRead::DerefACI()
 {
+    if (m_aci == UnknownAci)
+    {
+        // in a chunk, the colour from before it; kept, unless that turns out to be 256
+        m_needs_start_aci = true;
+        return;
+    }
 
     if (m_aci == 256) // if color = layer color, replace by color from layer
     {
-         m_aci = m_layer_aci[std::string(m_layer_name)];
+        if (m_layer_name == UnknownLayer)
+        {
+            // in a chunk, which has to be read again once the layer is known
+            m_reread = true;
+            return;
+        }
+        LayerAciMap_t::const_iterator it = m_layer_aci.find(m_layer_name);
+        m_aci = (it == m_layer_aci.end()) ? 0 : it->second;
     }
 }
 
+void CDxfRead::Report(const char* format, ...)const
+{
+	// chunks read on other threads are quiet; one that fails is read again here, with its messages
+	if(m_in_chunk)return;
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
+
 std::string CDxfRead::LayerName() const
 {
     std::string result;
 
-    if (strlen(m_section_name) > 0)
+    if (!m_section_name.empty())
     {
 		result.append(m_section_name);
     }
 
-    if (strlen(m_block_name) > 0)
+    if (!m_block_name.empty())
     {
         result.append(" ");
 		result.append(m_block_name);
     }
 
-    if (strlen(m_layer_name) > 0)
+    if (!m_layer_name.empty())
     {
         result.append(" ");
 		result.append(m_layer_name);
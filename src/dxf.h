@@ -12,6 +12,8 @@
 #include <memory>
 #include <sstream>
 #include <iostream>
+#include <string>
+#include <string_view>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
@@ -49,6 +51,7 @@ typedef enum
 } eDxfUnits_t;
 
 
+// a SPLINE entity; the control and fit points are in mm, like the other entities' points
 struct SplineData
 {
 	double norm[3];
@@ -57,29 +60,39 @@ struct SplineData
 	int control_points;
 	int fit_points;
 	int flag;
-	std::list<double> starttanx;
-	std::list<double> starttany;
-	std::list<double> starttanz;
-	std::list<double> endtanx;
-	std::list<double> endtany;
-	std::list<double> endtanz;
-	std::list<double> knot;
-	std::list<double> weight;
-	std::list<double> controlx;
-	std::list<double> controly;
-	std::list<double> controlz;
-	std::list<double> fitx;
-	std::list<double> fity;
-	std::list<double> fitz;
+	std::vector<double> starttanx;
+	std::vector<double> starttany;
+	std::vector<double> starttanz;
+	std::vector<double> endtanx;
+	std::vector<double> endtany;
+	std::vector<double> endtanz;
+	std::vector<double> knot;
+	std::vector<double> weight;
+	std::vector<double> controlx;
+	std::vector<double> controly;
+	std::vector<double> controlz;
+	std::vector<double> fitx;
+	std::vector<double> fity;
+	std::vector<double> fitz;
 };
 
 class CDxfWrite{
 private:
 	std::unique_ptr<std::ofstream> m_ofs;
+	std::vector<char> m_buffer; // written to m_ofs when full, and at the end, rather than a line at a time
+	size_t m_used;
 	bool m_fail;
+	bool m_binary;
+
+	void Put(const char* data, size_t size);
+	void Flush();
+	void WriteCode(int code);
+	void WriteGroup(int code, const char* value);
+	void WriteGroup(int code, double value);
+	void WriteGroup(int code, int value);
 
 public:
-	CDxfWrite(const char* filepath);
+	CDxfWrite(const char* filepath, bool binary = false); // binary writes an AutoCAD binary DXF
 	~CDxfWrite();
 
 	bool Failed(){return m_fail;}
@@ -89,21 +102,62 @@ public:
 	void WriteArc(const double* s, const double* e, const double* c, bool dir, const char* layer_name );
     void WriteEllipse(const double* c, double major_radius, double minor_radius, double rotation, double start_angle, double end_angle, bool dir, const char* layer_name );
 	void WriteCircle(const double* c, double radius, const char* layer_name );
+	void WriteLwPolyLine(const double* xy, const double* bulges, int num_points, bool closed, const char* layer_name ); // xy has x and y of each point; bulges may be null
+};
+
+// the whole of a file in memory; mapped where the platform allows it, otherwise read in
+class CDxfFile{
+private:
+	const char* m_data;
+	size_t m_size;
+	bool m_fail;
+	bool m_mapped;
+	std::vector<char> m_buffer;
+
+public:
+	CDxfFile(const char* filepath);
+	~CDxfFile();
+	CDxfFile(const CDxfFile&) = delete;
+	CDxfFile& operator=(const CDxfFile&) = delete;
+
+	bool Failed()const{return m_fail;}
+	const char* Data()const{return m_data;}
+	size_t Size()const{return m_size;}
 };
 
+class CDxfChunkRead;
+
 // derive a class from this and implement it's virtual functions
 class CDxfRead{
+	friend class CDxfChunkRead;
+
 private:
-	std::unique_ptr<std::ifstream> m_ifs;
+	std::shared_ptr<CDxfFile> m_file;
+	size_t m_pos; // of the next line in m_file
+	size_t m_end; // of the part of m_file being read
+	bool m_eof;
+	bool m_in_chunk; // a CDxfChunkRead, reading part of the ENTITIES section on another thread
+	bool m_needs_start_aci; // in a chunk, the colour from before the chunk was used
+	bool m_reread; // in a chunk, which must be read again once the layer and colour before it are known
+	bool m_binary; // an AutoCAD binary DXF
+	bool m_binary_short_codes; // a binary DXF from before R13, with one byte group codes
+	int m_binary_code; // in a binary DXF, the group code whose value is next, or -1 if a group code is next
+	bool m_is_number; // m_str was a number in a binary DXF, which is in m_number
+	double m_number;
+	char m_number_text[24]; // what m_str points to for a binary group code or integer
 
 	bool m_fail;
-	char m_str[1024];
-	char m_unused_line[1024];
+	std::string_view m_str; // the current line, pointing into m_file
+	std::string_view m_unused_line;
+	bool m_line_unused;
 	eDxfUnits_t m_eUnits;
-	char m_layer_name[1024];
-	char m_section_name[1024];
-	char m_block_name[1024];
+	std::string m_layer_name;
+	std::string m_section_name;
+	std::string m_block_name;
 	bool m_ignore_errors;
+	std::set<std::string, std::less<>> m_layer_filter; // if not empty, only entities on these layers are read
+	bool m_entities_only; // sections other than HEADER, TABLES and ENTITIES are stepped over
+	unsigned int m_read_threads; // threads used to read big ENTITIES sections, 0 for one per hardware thread
 
 	struct PolyState {
 		bool prev_found = false;
@@ -138,11 +192,26 @@ private:
 	void OnReadCircle(const double* c, double radius);
     void OnReadEllipse(const double* c, const double* m, double ratio, double start_angle, double end_angle);
 	bool ReadInsert();
+	bool ReadBlock();
+	bool ReadEndBlock();
 	void AddPolyLinePoint(double x, double y, double z, bool bulge_found, double bulge);
 	void PolyLineStart();
 
+	CDxfRead(const CDxfRead& reader, size_t begin, size_t end);
+	bool ReadItems();
+	bool SkipEntity(bool polyline);
+	bool SkipPolyLine();
+	void SkipSection();
+	bool SplitEntities(std::vector<size_t>& starts)const;
+	bool ReadChunks(const std::vector<size_t>& starts);
+	bool ReplayChunk(CDxfChunkRead& chunk);
+	void Report(const char* format, ...)const;
+
 	void get_line();
-	void put_line(const char *value);
+	void get_binary_line();
+	void put_line(std::string_view value);
+	bool ParseValue(double& value)const; // the number in m_str
+	bool ParseValue(int& value)const;
 	void DerefACI();
 
 protected:
@@ -153,6 +222,10 @@ public:
 	~CDxfRead(); // this closes the file
 
 	bool Failed(){return m_fail;}
+	bool IsBinary()const{return m_binary;}
+	void SetLayerFilter(const std::vector<std::string>& layers); // read only the entities on these layers; all of them, if it is empty
+	void SetEntitiesOnly(bool entities_only){m_entities_only = entities_only;} // step over BLOCKS, OBJECTS and the other sections with nothing to draw
+	void SetReadThreads(unsigned int num_threads){m_read_threads = num_threads;} // read big ENTITIES sections on this many threads, 0 for one per hardware thread; 1, the default, for no more than this one
 	void DoRead(const bool ignore_errors = false); // this reads the file and calls the following functions
 
 	double mm( const double & value ) const;
@@ -167,6 +240,8 @@ public:
 	virtual void OnReadEllipse(const double* c, double major_radius, double minor_radius, double rotation, double start_angle, double end_angle, bool dir){}
 	virtual void OnReadSpline(struct SplineData& sd){}
 	virtual void OnReadInsert(const double* point, const double* scale, const char* name, double rotation){}
+	virtual void OnReadBlock(const char* name, const double* base){} // the entities up to OnReadEndBlock make up the block
+	virtual void OnReadEndBlock(){}
 	virtual void AddGraphics() const { }
 
     std::string LayerName() const;
@@ -15,6 +15,11 @@ namespace geoff_geometry {
 	const wchar_t* getMessage(const wchar_t* original){return original;}
 	void FAILURE(const wchar_t* str){throw(str);}
 	void FAILURE(const std::wstring& str){throw(str);}
+	void FAILURE(const wchar_t* str, int* status, int error){
+		// for callers that check a status rather than catch, eg the offset code
+		if(status == NULL) FAILURE(str);
+		*status = error;
+	}
 
 	// ostream operators  = non-member overload
 	// *********************************************************************************************************
@@ -100,6 +100,7 @@ inline bool FNEZ(double a, double tolerance = TIGHT_TOLERANCE) {return fabs(a) >
 	const wchar_t* getMessage(const wchar_t* original);							// dummy
 	void FAILURE(const wchar_t* str);
 	void FAILURE(const std::wstring& str);
+	void FAILURE(const wchar_t* str, int* status, int error);					// puts error in *status, if given, rather than throwing
 
 	enum MESSAGE_GROUPS {
 		GENERAL_MESSAGES,
@@ -556,8 +557,8 @@ inline bool FNEZ(double a, double tolerance = TIGHT_TOLERANCE) {return fabs(a) >
 		bool	NullSpan;	// true if small span
 
 		// methods
-		void SetProperties(bool returnProperties);									// set span properties
-		Span Offset(double offset);													// offset span method
+		void SetProperties(bool returnProperties, int* status = NULL);				// set span properties (bad arc -> MES_INVALIDARC)
+		Span Offset(double offset, int* status = NULL);								// offset span method
 		int Split(double tolerance);												// returns number of splits
 		void SplitMatrix(int num_vectors, Matrix* matrix);							// returns incremental matrix from split
 		void minmax(Box& box, bool start = true);									// minmax of span
@@ -694,7 +695,6 @@ inline bool FNEZ(double a, double tolerance = TIGHT_TOLERANCE) {return fabs(a) >
 
 
 
-#define SPANSTORAGE 32			// lessens number of object pointers
 
 	class spVertex {
 		friend wostream& operator <<(wostream& op, spVertex& sp);
@@ -731,26 +731,28 @@ inline bool FNEZ(double a, double tolerance = TIGHT_TOLERANCE) {return fabs(a) >
 		SpanDataObject(const SpanDataObject* obj){method = obj->method;};
 	};
 
-	class SpanVertex{
+	class SpanVertices{
+		// all the vertices of a kurve, one array for each field, so a kurve is a few allocations rather than one for every few spans
 	public:
-		int type[SPANSTORAGE];							// LINEAR CW or ACW																// 0 straight (cw = -1 (T)   acw = 1 (A) )
-		int spanid[SPANSTORAGE];						// identification (eg wire offset span info)
-		const SpanDataObject* index[SPANSTORAGE];					// other - pointer to 
-		double x[SPANSTORAGE], y[SPANSTORAGE];			// vertex
-		double xc[SPANSTORAGE], yc[SPANSTORAGE];		// centre of arc
+		vector<int> type;							// LINEAR CW or ACW		0 straight (cw = -1 (T)   acw = 1 (A) )
+		vector<int> spanid;							// identification (eg wire offset span info)
+		vector<const SpanDataObject*> index;		// other - pointer to, owned here
+		vector<double> x, y;						// vertex
+		vector<double> xc, yc;						// centre of arc
 	public:
 		// methods
-		void	Add(int offset, int type, const Point& p0, const Point& pc, int ID = UNMARKED);
-		const SpanDataObject* GetIndex(int offset)const;
-		void	AddSpanID(int offset, int ID);
-		SpanVertex();
-		~SpanVertex();
-		const SpanVertex& operator= (const SpanVertex& spv );
-
-		void	Add(int offset, const SpanDataObject* Index );
-		const SpanDataObject*	Get(int offset);
-		int		Get(int offset, Point& pe, Point& pc);
-		int GetSpanID(int offset);
+		SpanVertices(){};
+		SpanVertices(const SpanVertices& spv);
+		SpanVertices(SpanVertices&& spv) = default;
+		~SpanVertices();
+		const SpanVertices& operator= (const SpanVertices& spv );
+		const SpanVertices& operator= (SpanVertices&& spv );
+
+		inline int size()const {return (int)x.size();}
+		void	reserve(int n);
+		void	clear();
+		void	Add(int type, const Point& p0, const Point& pc, int ID = UNMARKED);					// append a vertex
+		void	Set(int offset, int type, const Point& p0, const Point& pc, int ID = UNMARKED);		// replace a vertex, not its index
 	};
 
 
@@ -766,7 +768,7 @@ inline bool FNEZ(double a, double tolerance = TIGHT_TOLERANCE) {return fabs(a) >
 	friend wifstream& operator >> (wifstream& op, Kurve& k);
 		
 	protected:
-		vector<SpanVertex*> m_spans;
+		SpanVertices m_spans;
 		bool		m_started;
 		int			m_nVertices;					// number of vertices in Kurve
 		bool		m_isReversed;					// true if get spans reversed
@@ -786,7 +788,9 @@ inline bool FNEZ(double a, double tolerance = TIGHT_TOLERANCE) {return fabs(a) >
 			m_isReversed = false;
 		};
 		Kurve(const Kurve& k0);
+		Kurve(Kurve&& k0);														// takes k0's spans, leaving it empty
 		const Kurve& operator= (const Kurve& k );
+		const Kurve& operator= (Kurve&& k );
 		const Kurve& operator=(const Matrix &m);
 
 		bool operator==(const Kurve &k)const;									// k == kk (vertex check)
@@ -813,6 +817,7 @@ inline bool FNEZ(double a, double tolerance = TIGHT_TOLERANCE) {return fabs(a) >
 		void	Add(const Kurve* k, bool AddNullSpans = true);									// a kurve
 		void	StoreAllSpans(std::vector<Span>& kSpans)const;			// store all kurve spans in array, normally when fast access is reqd
 		void	Clear(); // remove all the spans
+		void	Reserve(int nVertices) {m_spans.reserve(nVertices);}	// room for nVertices, when the size is known before adding
 
 		void	Replace(int vertexnumber, const spVertex& spv);
 		void	Replace(int vertexnumber, int type, const Point& p, const Point& pc, int ID = UNMARKED);
@@ -821,7 +826,7 @@ inline bool FNEZ(double a, double tolerance = TIGHT_TOLERANCE) {return fabs(a) >
 		void	Get(std::vector<Span> *all, bool ignoreNullSpans) const;												// get all spans to vector
 		int		Get(int spanVertexNumber, Point3d& p, Point3d& pc) const 
 		{ Point p2d, pc2d; int d = Get(spanVertexNumber, p2d, pc2d); p = p2d; pc = pc2d; return d;}
-		int		Get(int spannumber, Span& sp, bool returnSpanProperties = false, bool transform = false) const;
+		int		Get(int spannumber, Span& sp, bool returnSpanProperties = false, bool transform = false, int* status = NULL) const;
 //		int		Get(int spannumber, Span3d& sp, bool returnSpanProperties = false, bool transform = false) const;
 		void	Get(Point &ps,Point &pe) const; // returns the start- and endpoint of the kurve
 		const SpanDataObject* GetIndex(int vertexNumber)const;
@@ -835,7 +840,7 @@ inline bool FNEZ(double a, double tolerance = TIGHT_TOLERANCE) {return fabs(a) >
 		Point	Near(const Point& p, int& nearSpanNumber)const;
 		Point	Near(const Point& p) const{ int nearSpanNumber; return Near(p, nearSpanNumber);};
 		double	Perim()const;									// perimeter of kurve
-		double	Area()const;										// area of closed kurve
+		double	Area(int* status = NULL)const;						// area of closed kurve
 		void	Reverse();									// reverse kurve direction - obsolete
 		bool	Reverse(bool isReversed) {					// reverse kurve direction - later better method
 			bool tmp = m_isReversed;
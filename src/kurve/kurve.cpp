@@ -17,91 +17,96 @@ using namespace geoff_geometry;
 
 namespace geoff_geometry {
 
-	SpanVertex::SpanVertex() {
-		for(int i = 0; i < SPANSTORAGE; i++) index[i] = NULL;
+	SpanVertices::SpanVertices(const SpanVertices& spv) {
+		*this = spv;
 	}
 
-	SpanVertex::~SpanVertex() {
-#ifndef PEPSDLL 
-		// don't know what peps did about this?
-		for(int i = 0; i < SPANSTORAGE; i++) {
-			if(index[i] != NULL) {
-				delete index[i];
-			}
+	SpanVertices::~SpanVertices() {
+		clear();
+	}
+
+	const SpanVertices& SpanVertices::operator= (const SpanVertices& spv ){
+		/// copies the index objects too
+		if(this == &spv) return *this;
+		clear();
+		type = spv.type;
+		spanid = spv.spanid;
+		x = spv.x;
+		y = spv.y;
+		xc = spv.xc;
+		yc = spv.yc;
+		index = spv.index;
+#ifndef PEPSDLL
+		for(unsigned int i = 0; i < index.size(); i++) {
+			if(index[i] != NULL) index[i] = new SpanDataObject(index[i]);
 		}
 #endif
+		return *this;
 	}
 
-	const SpanVertex& SpanVertex::operator= (const SpanVertex& spv ){
-		/// 
+	const SpanVertices& SpanVertices::operator= (SpanVertices&& spv ){
+		if(this == &spv) return *this;
+		clear();
+		type = std::move(spv.type);
+		spanid = std::move(spv.spanid);
+		index = std::move(spv.index);
+		x = std::move(spv.x);
+		y = std::move(spv.y);
+		xc = std::move(spv.xc);
+		yc = std::move(spv.yc);
+		spv.index.clear();		// the index objects belong to this now
+		spv.clear();
+		return *this;
+	}
 
-		memcpy(x, spv.x, SPANSTORAGE * sizeof(double));
-		memcpy(y, spv.y, SPANSTORAGE * sizeof(double));
-		memcpy(xc, spv.xc, SPANSTORAGE * sizeof(double));
-		memcpy(yc, spv.yc, SPANSTORAGE * sizeof(double));
+	void SpanVertices::reserve(int n) {
+		type.reserve(n);
+		spanid.reserve(n);
+		index.reserve(n);
+		x.reserve(n);
+		y.reserve(n);
+		xc.reserve(n);
+		yc.reserve(n);
+	}
 
-		for(unsigned int i = 0; i < SPANSTORAGE; i++) {
-			type[i] = spv.type[i];
-			spanid[i] = spv.spanid[i];
-			index[i] = spv.index[i];
-#ifndef PEPSDLL
-			if(index[i] != NULL) {
-				SpanDataObject* obj = new SpanDataObject(index[i]);
-				index[i] = obj;
-			}
-#endif
+	void SpanVertices::clear() {
+#ifndef PEPSDLL 
+		// don't know what peps did about this?
+		for(unsigned int i = 0; i < index.size(); i++) {
+			if(index[i] != NULL) delete index[i];
 		}
-		return *this;
+#endif
+		type.clear();
+		spanid.clear();
+		index.clear();
+		x.clear();
+		y.clear();
+		xc.clear();
+		yc.clear();
 	}
 
+	void SpanVertices::Add(int spantype, const Point& p, const Point& pc, int ID)
+	{
+		type.push_back(spantype);
+		spanid.push_back(ID);
+		index.push_back(NULL);
+		x.push_back(p.x);
+		y.push_back(p.y);
+		xc.push_back(pc.x);
+		yc.push_back(pc.y);
+	}
 
-	void SpanVertex::Add(int offset, int spantype, const Point& p, const Point& pc, int ID)
+	void SpanVertices::Set(int offset, int spantype, const Point& p, const Point& pc, int ID)
 	{
 		type[offset] = spantype;
-//		index[offset] = NULL;
 		x[offset] = p.x;
 		y[offset] = p.y;
 		xc[offset] = pc.x;
 		yc[offset] = pc.y;
 		spanid[offset] = ID;
 	}
-	void SpanVertex::AddSpanID(int offset, int ID)
-	{
-		spanid[offset] = ID;
-	}
-
-#if PEPSDLL
-	void SpanVertex::Add(int offset, WireExtraData* Index )
-	{
-		index[offset] = Index;
-	}
-	WireExtraData* SpanVertex::Get(int offset)
-	{
-		return index[offset];
-	}
-#else
-	void SpanVertex::Add(int offset, const SpanDataObject* Index ) {
-		index[offset] = Index;
-	}
-		
-	const SpanDataObject* SpanVertex::GetIndex(int offset) const{
-		return index[offset];
-	}
-#endif
 
-	int SpanVertex::Get(int offset, Point& pe, Point& pc)
-	{
-		pe = Point(x[offset], y[offset]);
-		pc = Point(xc[offset], yc[offset]);
-
-		return type[offset];
-	}
-	int SpanVertex::GetSpanID(int offset)
-	{
-		return spanid[offset];
-	}
-
-	Span Span::Offset(double offset)
+	Span Span::Offset(double offset, int* status)
 	{
 		Span Offsp = *this;
 		if(FNEZ(offset) && !NullSpan) {
@@ -124,7 +129,7 @@ namespace geoff_geometry {
 
 //				Offsp.radius -= dir * offset;
 			}
-			Offsp.SetProperties(true);
+			Offsp.SetProperties(true, status);
 		}
 		return Offsp;
 	}
@@ -422,11 +427,7 @@ namespace geoff_geometry {
 		this->m_mirrored = k.m_mirrored;
 		this->m_isReversed = k.m_isReversed;
 		this->m_started = k.m_started;
-		for(unsigned int i = 0; i < k.m_spans.size(); i++) {
-			SpanVertex* spv = new SpanVertex;
-			*spv = *k.m_spans[i];
-			this->m_spans.push_back(spv);
-		}
+		this->m_spans = k.m_spans;
 	}
 
 	const Kurve& Kurve::operator=( const Kurve &k) {
@@ -445,12 +446,34 @@ namespace geoff_geometry {
 //			k.Get(i, spv);
 //			Add(spv);
 //		}
-		for(unsigned int i = 0; i < k.m_spans.size(); i++) {
-			SpanVertex* spv = new SpanVertex;
-			*spv = *k.m_spans[i];
-			this->m_spans.push_back(spv);
-		}
+		m_spans = k.m_spans;
+		m_nVertices = k.m_nVertices;
+		return *this;
+	}
+
+	Kurve::Kurve(Kurve&& k) :Matrix(), m_spans(std::move(k.m_spans)) {
+		m_nVertices = k.m_nVertices;
+		memcpy(e, k.e, 16 * sizeof(double));
+		m_unit = k.m_unit;
+		m_mirrored = k.m_mirrored;
+		m_isReversed = k.m_isReversed;
+		m_started = k.m_started;
+		k.Clear();
+	}
+
+	const Kurve& Kurve::operator=(Kurve&& k) {
+		if(this == &k) return *this;
+		memcpy(e, k.e, 16 * sizeof(double));
+		m_unit = k.m_unit;
+		m_mirrored = k.m_mirrored;
+		m_isReversed = k.m_isReversed;
+
+		this->Clear();
+
+		if(k.m_nVertices) m_started = true;
+		m_spans = std::move(k.m_spans);
 		m_nVertices = k.m_nVertices;
+		k.Clear();
 		return *this;
 	}
 
@@ -589,24 +612,14 @@ return;
 			}
 		}
 
-		SpanVertex* p;
-		if(m_nVertices % SPANSTORAGE == 0) {
-			p = new SpanVertex;
-			m_spans.push_back(p);
-		}
-		else 
-			p = (SpanVertex*) m_spans[m_nVertices / SPANSTORAGE];
-
-		p->Add(m_nVertices % SPANSTORAGE, span_type, p0, pc);
+		m_spans.Add(span_type, p0, pc);
 		m_nVertices++;
 		return true;
 	}
 	void Kurve::AddSpanID(int ID)
 	{
 		// add a extra data - must be called after Add
-		int vertex = this->m_nVertices - 1;
-		SpanVertex* p = (SpanVertex*) m_spans[vertex / SPANSTORAGE];
-		p->AddSpanID(vertex % SPANSTORAGE, ID);
+		m_spans.spanid[this->m_nVertices - 1] = ID;
 	}
 
 	void Kurve::Add() {
@@ -678,8 +691,7 @@ return;
 #ifdef _DEBUG
 		if(this == NULL || vertexnumber > m_nVertices) FAILURE(getMessage(L"Kurve::Replace - vertexNumber out of range"));
 #endif
-		SpanVertex* p = (SpanVertex*) m_spans[vertexnumber / SPANSTORAGE];
-		p->Add(vertexnumber % SPANSTORAGE, type, p0, pc, ID);
+		m_spans.Set(vertexnumber, type, p0, pc, ID);
 	}
 
 #ifdef PEPSDLL
@@ -688,20 +700,17 @@ return;
 #ifdef _DEBUG
 		if(this == NULL || vertexnumber > m_nVertices) FAILURE(getMessage(L"Kurve::ModifyIndex - vertexNumber out of range"));
 #endif
-		SpanVertex* p = (SpanVertex*) m_spans[vertexnumber / SPANSTORAGE];
-		p->Add(vertexnumber % SPANSTORAGE, i);
+		m_spans.index[vertexnumber] = i;
 	}
 #else
 	void Kurve::AddIndex(int vertexNumber, const SpanDataObject* data) {
 		if(vertexNumber > m_nVertices - 1) FAILURE(L"Kurve::AddIndex - vertexNumber out of range");
-		SpanVertex* p = (SpanVertex*) m_spans[vertexNumber / SPANSTORAGE];
-		p->Add(vertexNumber % SPANSTORAGE, data);
+		m_spans.index[vertexNumber] = data;
 	}
 
 	const SpanDataObject* Kurve::GetIndex(int vertexNumber)const {
 		if(vertexNumber > m_nVertices - 1) FAILURE(L"Kurve::GetIndex - vertexNumber out of range");
-		SpanVertex* p = (SpanVertex*) m_spans[vertexNumber / SPANSTORAGE];
-		return p->GetIndex(vertexNumber % SPANSTORAGE);
+		return m_spans.index[vertexNumber];
 	}
 
 
@@ -726,40 +735,35 @@ return;
 		if(vertexnumber < 0 || vertexnumber >= m_nVertices) FAILURE(getMessage(L"Kurve::Get - vertexNumber out of range"));
 		if(m_isReversed == true) {
 			int revVertexnumber = m_nVertices - 1 - vertexnumber;
-			SpanVertex* p = (SpanVertex*)m_spans[revVertexnumber / SPANSTORAGE];
-			int offset = revVertexnumber % SPANSTORAGE;
-			pe = Point(p->x[offset], p->y[offset]);
+			pe = Point(m_spans.x[revVertexnumber], m_spans.y[revVertexnumber]);
 			if(vertexnumber > 0) {
 				revVertexnumber++;
-				offset = revVertexnumber % SPANSTORAGE;
-				p = (SpanVertex*)m_spans[revVertexnumber / SPANSTORAGE];
-				pc = Point(p->xc[offset], p->yc[offset]);
-				return -p->type[offset];
+				pc = Point(m_spans.xc[revVertexnumber], m_spans.yc[revVertexnumber]);
+				return -m_spans.type[revVertexnumber];
 			}
 			else return LINEAR;
 		}
 		else {
-			SpanVertex* p = (SpanVertex*)m_spans[vertexnumber / SPANSTORAGE];
-			return p->Get(vertexnumber % SPANSTORAGE, pe, pc);
+			pe = Point(m_spans.x[vertexnumber], m_spans.y[vertexnumber]);
+			pc = Point(m_spans.xc[vertexnumber], m_spans.yc[vertexnumber]);
+			return m_spans.type[vertexnumber];
 		}
 	}
 	int	Kurve::GetSpanID(int vertexnumber) const {
 		// for spanID (wire offset)
 		if(vertexnumber < 0 || vertexnumber >= m_nVertices) FAILURE(getMessage(L"Kurve::Get - vertexNumber out of range"));
 		if(m_isReversed == true) vertexnumber = m_nVertices - 1 - vertexnumber;
-		SpanVertex* p = (SpanVertex*)m_spans[vertexnumber / SPANSTORAGE];
-		return p->GetSpanID(vertexnumber % SPANSTORAGE);
+		return m_spans.spanid[vertexnumber];
 	}
-	int Kurve::Get(int spannumber, Span& sp, bool returnSpanProperties, bool transform) const {
+	int Kurve::Get(int spannumber, Span& sp, bool returnSpanProperties, bool transform, int* status) const {
 		// returns span data and optional properties - the function returns as the span type
 		if(spannumber < 1 || spannumber > m_nVertices) FAILURE(getMessage(L"Kurve::Get - vertexNumber out of range"));
 		if(m_nVertices < 2) return -99;
 
 		int spanVertexNumber = spannumber - 1;
 		if(m_isReversed) spanVertexNumber = m_nVertices - 1 - spanVertexNumber;
-		SpanVertex* p = (SpanVertex*)m_spans[spanVertexNumber / SPANSTORAGE];
-		sp.p0.x = p->x[spanVertexNumber % SPANSTORAGE];
-		sp.p0.y = p->y[spanVertexNumber % SPANSTORAGE];
+		sp.p0.x = m_spans.x[spanVertexNumber];
+		sp.p0.y = m_spans.y[spanVertexNumber];
 		sp.p0.ok = 1;
 
 		sp.dir = Get(spannumber, sp.p1, sp.pc);
@@ -770,7 +774,7 @@ return;
 			sp.Transform(*m, false);
 		}
 
-		sp.SetProperties(returnSpanProperties);
+		sp.SetProperties(returnSpanProperties, status);
 
 		return sp.dir;
 	}
@@ -782,9 +786,8 @@ return;
 		if(m_nVertices < 2) return -99;
 
 		int spanVertexNumber = spannumber - 1;
-		SpanVertex* p = (SpanVertex*)m_spans[spanVertexNumber / SPANSTORAGE];
-		sp.p0.x = p->x[spanVertexNumber % SPANSTORAGE];
-		sp.p0.y = p->y[spanVertexNumber % SPANSTORAGE];
+		sp.p0.x = m_spans.x[spanVertexNumber];
+		sp.p0.y = m_spans.y[spanVertexNumber];
 		sp.p0.z = 0;
 //		sp.p0.ok = 1;
 
@@ -811,7 +814,7 @@ return;
 		pe = sp.p1;
 	}
 
-	void Span::SetProperties(bool returnProperties) {
+	void Span::SetProperties(bool returnProperties, int* status) {
 		returnSpanProperties = returnProperties;
 		if(returnSpanProperties) {
 			// return span properties
@@ -828,7 +831,8 @@ return;
 				double radCheck = ve.normalise();
 //				if(FNE(radius, radCheck, geoff_geometry::TOLERANCE * 0.5)){
 				if(FNE(radius, radCheck, geoff_geometry::TOLERANCE)){
-					FAILURE(getMessage(L"Invalid Geometry - Radii mismatch - SetProperties"));
+					FAILURE(getMessage(L"Invalid Geometry - Radii mismatch - SetProperties"), status, MES_INVALIDARC);
+					return;
 				}
 				
 				length = 0.0;
@@ -1071,11 +1075,6 @@ return;
 
 	void Kurve::Clear()
 	{
-		for(vector<SpanVertex*>::iterator It = m_spans.begin(); It != m_spans.end(); It++)
-		{
-			SpanVertex* spv = *It;
-			delete spv;
-		}
 		m_spans.clear();
 		m_started = false;
 		m_nVertices = 0;
@@ -1107,16 +1106,21 @@ return;
 		}
 		return perim * xscale;
 	}
-	double Kurve::Area() const{
+	double Kurve::Area(int* status) const{
 		// returns Area of kurve (+ve clockwise , -ve anti-clockwise sense)
 		double xscale = 1.0;
 		double area = 0;
 		Span sp;
 
 		if(Closed()) {
-			if(!GetScale(xscale)) FAILURE(getMessage(L"Differential Scale not allowed for this method"));	// differential scale
+			if(!GetScale(xscale)) {
+				FAILURE(getMessage(L"Differential Scale not allowed for this method"), status, MES_DIFFSCALE);	// differential scale
+				return 0;
+			}
 			for(int i = 1; i < m_nVertices; i++) {			
-				if(Get(i, sp, true))
+				int dir = Get(i, sp, true, false, status);
+				if(status && *status) return 0;
+				if(dir)
 					area += ( 0.5 * ((sp.pc.x - sp.p0.x) * (sp.pc.y + sp.p0.y) - (sp.pc.x - sp.p1.x) * (sp.pc.y + sp.p1.y) - sp.angle * sp.radius * sp.radius));
 				else
 					area += 0.5 * (sp.p1.x - sp.p0.x) * (sp.p0.y + sp.p1.y);
@@ -40,6 +40,8 @@ namespace geoff_geometry {
 		//		= 1		- kurve has differential scale (not allowed)
 		//		= 2		- offset failed
 		//      = 3		- offset too large
+		//		= 4		- invalid geometry, eg an arc with different radii at its ends
+		// geometry errors come back in ret, they are not thrown
 		if(this == &kOffset) FAILURE(L"Illegal Call - 'this' must not be kOffset");
 		double offset = (direction == GEOFF_LEFT)?off : -off;
 
@@ -52,9 +54,11 @@ namespace geoff_geometry {
 		Span curSpan, curSpanOff;	// current & offset spans
 		Span prevSpanOff;			// previous offset span
 		Point p0, p1;				// Offset span intersections
+		int status = 0;				// set by span methods on invalid geometry
 
 		// offset Kurve
 		kOffset = Matrix(*this);
+		kOffset.Reserve(m_nVertices);
 
 		if(m_mirrored) offset = -offset;
 		int RollDir = ( off < 0 ) ? direction : - direction;				// Roll arc direction
@@ -69,21 +73,33 @@ namespace geoff_geometry {
 		bool bClosed = Closed();
 		int nspans = nSpans();
 		if(bClosed) {
-			Get(nspans, curSpan, true);						// assign previus span for closed
+			Get(nspans, curSpan, true, false, &status);						// assign previus span for closed
 
-			prevSpanOff = curSpan.Offset(offset);
+			if(status == 0) prevSpanOff = curSpan.Offset(offset, &status);
+			if(status) {
+				ret = 4;
+				return 0;
+			}
 			nspans++; // read first again
 		}
 
 		for(int spannumber = 1; spannumber <= nspans; spannumber++) {
 			if(spannumber > nSpans())
-				Get(1, curSpan, true);						// closed kurve - read first span again
+				Get(1, curSpan, true, false, &status);						// closed kurve - read first span again
 			else
-				Get(spannumber, curSpan, true);
+				Get(spannumber, curSpan, true, false, &status);
+			if(status) {
+				ret = 4;
+				return 0;
+			}
 
 			if(!curSpan.NullSpan) {
 				int numint = 0;
-				curSpanOff = curSpan.Offset(offset);
+				curSpanOff = curSpan.Offset(offset, &status);
+				if(status) {
+					ret = 4;
+					return 0;
+				}
 				curSpanOff.ID = 0;
 				if(!kOffset.m_started) {
 					kOffset.Start(curSpanOff.p0);
@@ -145,12 +161,14 @@ namespace geoff_geometry {
 		if(ret == 0 && bClosed) {
 			// check for inverted offsets of closed kurves
 			if(kOffset.Closed()) {
-				double a = Area();
+				double a = Area(&status);
 				int dir = (a < 0);
-				double ao = kOffset.Area();
+				double ao = kOffset.Area(&status);
 				int dirOffset = ao < 0;
 
-				if(dir != dirOffset)
+				if(status)
+					ret = 4;
+				else if(dir != dirOffset)
 					ret = 3;
 				else {
 					// check area change compatible with offset direction - catastrophic failure
@@ -172,12 +190,15 @@ namespace geoff_geometry {
 		//
 		// ret = 0 for ok
 		// ret = 2 for impossible geometry
+		// ret = 4 for invalid geometry, eg an arc with different radii at its ends
 		
 		Span sp0, sp1;
 		Point pInt, pIntOther;
+		int status = 0;										// set by span methods on invalid geometry
 
 		Kurve ko;											// eliminated output
 		ko = Matrix(k);
+		ko.Reserve(k.nSpans() + 1);
 		int kinVertex = 0;
 
 		while(kinVertex <= k.nSpans()) {
@@ -194,7 +215,11 @@ namespace geoff_geometry {
 				sp0.dir = k.Get(kinVertex, sp0.p1, sp0.pc);	// first span
 				sp0.ID = k.GetSpanID(kinVertex++);
 
-				sp0.SetProperties(true);
+				sp0.SetProperties(true, &status);
+				if(status) {
+					ret = 4;
+					return ko;
+				}
 
 				int ksaveVertex1 = kinVertex;									// mark position AA		
 				if (kinVertex <= k.nSpans()) {	// get the next but one span			
@@ -206,7 +231,11 @@ namespace geoff_geometry {
 					while(kinVertex <= k.nSpans()) {					
 						sp1.dir = k.Get(kinVertex, sp1.p1, sp1.pc);			// check span
 						sp1.ID = k.GetSpanID(kinVertex++);
-						sp1.SetProperties(true);
+						sp1.SetProperties(true, &status);
+						if(status) {
+							ret = 4;
+							return ko;
+						}
 			
 						double t[4];
 						int numint = sp0.Intof(sp1, pInt, pIntOther, t);			// find span intersections
@@ -217,11 +246,15 @@ namespace geoff_geometry {
 								// choose first intercept on sp0
 								Span spd = sp0;
 								spd.p1 = pInt;
-								spd.SetProperties(true);
+								spd.SetProperties(true, &status);
 								double dd = spd.length;
 
 								spd.p1 = pIntOther;
-								spd.SetProperties(true);
+								spd.SetProperties(true, &status);
+								if(status) {
+									ret = 4;
+									return ko;
+								}
 								if(dd > spd.length) pInt = pIntOther;
 								numint = 1;
 
@@ -0,0 +1,1503 @@
+// bench.cpp
+// Timings and work counters for libarea's hot paths.
+// Run with no arguments for every benchmark, or name the ones wanted, e.g. "area-bench pocket".
+
+#include "../src/Area.h"
+#include "../src/AreaDxf.h"
+#include "../src/BulgeCurve.h"
+#include "../src/Curve.h"
+#include "../src/PreparedArea.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const double ACCURACY = 0.01;
+
+// every heap allocation the process makes, so a bench can say how many an operation needs
+static std::atomic<unsigned long> num_allocations(0);
+
+// the whole set is replaced so every new is paired with the matching delete
+static void* countedAlloc(size_t size, size_t align) {
+    num_allocations++;
+    void* p = nullptr;
+    if (align == 0) p = malloc(size ? size : 1);
+    else p = aligned_alloc(align, (size + align - 1) / align * align);
+    if (p) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return countedAlloc(size, 0); }
+void* operator new[](size_t size) { return countedAlloc(size, 0); }
+void* operator new(size_t size, std::align_val_t align) { return countedAlloc(size, (size_t)align); }
+void* operator new[](size_t size, std::align_val_t align) { return countedAlloc(size, (size_t)align); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+
+// ---------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------
+
+class Timer {
+    std::chrono::steady_clock::time_point m_start;
+public:
+    Timer() : m_start(std::chrono::steady_clock::now()) {}
+    double ms() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+};
+
+// Two-arc CCW circle
+static void makeCircle(CCurve& c, const Point& center, double radius) {
+    c.append(center + Point(radius, 0));
+    c.append(CVertex(CVertex::vt_ccw_arc, center + Point(-radius, 0), center));
+    c.append(CVertex(CVertex::vt_ccw_arc, center + Point( radius, 0), center));
+}
+
+static void makeRect(CCurve& c, const Point& p0, double w, double h) {
+    c.append(p0);
+    c.append(p0 + Point(w, 0));
+    c.append(p0 + Point(w, h));
+    c.append(p0 + Point(0, h));
+    c.append(p0);
+}
+
+// A plate with rounded slots cut in it and a grid of holes, the sort of part we pocket every day
+static CArea makePart(int holes_x, int holes_y) {
+    CArea part(ACCURACY);
+    CCurve outline;
+    makeRect(outline, Point(0, 0), 40.0 * holes_x + 20.0, 40.0 * holes_y + 20.0);
+    part.append(outline);
+
+    CArea holes(ACCURACY);
+    for (int i = 0; i < holes_x; i++) {
+        for (int j = 0; j < holes_y; j++) {
+            CCurve hole;
+            makeCircle(hole, Point(30.0 + 40.0 * i, 30.0 + 40.0 * j), 6.0 + (i + j) % 3);
+            holes.append(hole);
+        }
+    }
+    part.Subtract(holes);
+    return part;
+}
+
+static size_t numVertices(const std::list<CCurve>& curves) {
+    size_t n = 0;
+    for (const auto& c : curves) n += c.m_vertices.size();
+    return n;
+}
+
+static size_t numVertices(const CArea& a) {
+    return numVertices(a.m_curves);
+}
+
+// ---------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------
+
+static void benchPocket() {
+    CArea part = makePart(4, 3);
+    CAreaPocketParams params(3.0, 0.0, 2.5, false, PocketMode::Spiral, 0.0);
+
+#ifdef AREA_COUNTERS
+    CArea::counters.Reset();
+#endif
+    Timer t;
+    std::list<CCurve> toolpath;
+    part.SplitAndMakePocketToolpath(toolpath, params);
+    double ms = t.ms();
+
+    printf("pocket: %lu curves in %.1f ms\n", (unsigned long)toolpath.size(), ms);
+#ifdef AREA_COUNTERS
+    printf("  reorders done %lu, skipped %lu, split copies skipped %lu\n",
+           CArea::counters.reorders_done.load(), CArea::counters.reorders_skipped.load(),
+           CArea::counters.split_copies_skipped.load());
+#endif
+
+    // the same, with no arcs fitted to the toolpath
+    CAreaProcessingContext ctx;
+    ctx.fit_arcs = false;
+    Timer t2;
+    std::list<CCurve> line_toolpath;
+    part.SplitAndMakePocketToolpath(line_toolpath, params, &ctx);
+    double lines_ms = t2.ms();
+    printf("  without fitting arcs: %lu vertices in %.1f ms, fitted: %lu vertices\n",
+           (unsigned long)numVertices(line_toolpath), lines_ms, (unsigned long)numVertices(toolpath));
+}
+
+// the test IsInside used to do: intersect a tiny square with the area and look at what is left
+static bool clipperIsInside(const Point& p, const CArea& a) {
+    CArea a2(a.m_accuracy);
+    CCurve c;
+    makeRect(c, Point(p.x - 0.01, p.y - 0.01), 0.02, 0.02);
+    a2.append(c);
+    a2.Intersect(a);
+    return fabs(a2.GetArea()) >= 0.0004;
+}
+
+// simple repeatable pseudo random numbers
+class Random {
+    unsigned long long m_state;
+public:
+    Random(unsigned long long seed = 12345) : m_state(seed) {}
+    double next(double lo, double hi) {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return lo + (hi - lo) * (double)(m_state >> 11) / 9007199254740992.0;
+    }
+};
+
+static std::vector<Point> randomPoints(const CArea& a, size_t n) {
+    CBox2D box;
+    a.GetBox(box);
+    Random r;
+    std::vector<Point> pts(n);
+    for (auto& p : pts) p = Point(r.next(box.MinX(), box.MaxX()), r.next(box.MinY(), box.MaxY()));
+    return pts;
+}
+
+static void benchInside() {
+    CArea part = makePart(10, 10);
+    const size_t num_pts = 1000000;
+    std::vector<Point> pts = randomPoints(part, num_pts);
+
+    const size_t num_clipper = 2000;
+    Timer tc;
+    std::vector<bool> clipper_inside(num_clipper);
+    for (size_t i = 0; i < num_clipper; i++) clipper_inside[i] = clipperIsInside(pts[i], part);
+    double clipper_ms = tc.ms();
+
+    Timer ts;
+    std::vector<bool> scalar_inside(num_pts);
+    for (size_t i = 0; i < num_pts; i++) scalar_inside[i] = IsInside(pts[i], part);
+    double scalar_ms = ts.ms();
+
+    Timer tb;
+    std::unique_ptr<bool[]> batch_inside(new bool[num_pts]);
+    IsInside(pts.data(), num_pts, part, batch_inside.get());
+    double batch_ms = tb.ms();
+
+    size_t differ_clipper = 0, differ_batch = 0, num_inside = 0;
+    for (size_t i = 0; i < num_pts; i++) {
+        if (i < num_clipper && clipper_inside[i] != scalar_inside[i]) differ_clipper++;
+        if (batch_inside[i] != scalar_inside[i]) differ_batch++;
+        if (scalar_inside[i]) num_inside++;
+    }
+
+    printf("inside: %lu points against %lu curves, %lu inside\n", (unsigned long)num_pts,
+           (unsigned long)part.num_curves(), (unsigned long)num_inside);
+    printf("  clipper square  %.3f us/point (%lu points, %lu disagree)\n", clipper_ms * 1000.0 / num_clipper,
+           (unsigned long)num_clipper, (unsigned long)differ_clipper);
+    printf("  winding         %.3f us/point, %.1f ms total\n", scalar_ms * 1000.0 / num_pts, scalar_ms);
+    printf("  winding batch   %.3f us/point, %.1f ms total (%lu disagree)\n", batch_ms * 1000.0 / num_pts, batch_ms,
+           (unsigned long)differ_batch);
+}
+
+static void benchPrepared() {
+    CArea part = makePart(10, 10);
+    const size_t num_pts = 1000000;
+    std::vector<Point> pts = randomPoints(part, num_pts);
+
+    std::unique_ptr<bool[]> batch_inside(new bool[num_pts]);
+    Timer tb;
+    IsInside(pts.data(), num_pts, part, batch_inside.get());
+    double batch_ms = tb.ms();
+
+    Timer tp;
+    CPreparedArea prepared(part);
+    double build_ms = tp.ms();
+
+    std::unique_ptr<bool[]> inside(new bool[num_pts]);
+    Timer tq;
+    for (size_t i = 0; i < num_pts; i++) inside[i] = prepared.IsInside(pts[i]);
+    double query_ms = tq.ms();
+
+    size_t differ = 0;
+    for (size_t i = 0; i < num_pts; i++) {
+        if (inside[i] != batch_inside[i]) differ++;
+    }
+
+    // the same prepared area, shared read-only between threads
+    unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+    Timer tt;
+    std::vector<std::thread> threads;
+    size_t per_thread = (num_pts + num_threads - 1) / num_threads;
+    for (unsigned t = 0; t < num_threads; t++) {
+        size_t start = t * per_thread;
+        size_t n = std::min(per_thread, num_pts - std::min(num_pts, start));
+        threads.emplace_back([&prepared, &pts, &inside, start, n]() {
+            prepared.IsInside(pts.data() + start, n, inside.get() + start);
+        });
+    }
+    for (auto& t : threads) t.join();
+    double threaded_ms = tt.ms();
+
+    printf("prepared: %lu spans in %lu cells (%lu span references), built in %.2f ms\n",
+           (unsigned long)prepared.num_spans(), (unsigned long)prepared.num_cells(),
+           (unsigned long)prepared.num_span_references(), build_ms);
+    printf("  winding batch   %.3f us/point\n", batch_ms * 1000.0 / num_pts);
+    printf("  prepared        %.3f us/point (%lu disagree)\n", query_ms * 1000.0 / num_pts, (unsigned long)differ);
+    printf("  prepared x %u threads  %.3f us/point\n", num_threads, threaded_ms * 1000.0 / num_pts);
+}
+
+// a polygon approximating a circle, with lots of short spans
+static void makePolygon(CCurve& c, const Point& center, double radius, int num_sides) {
+    for (int i = 0; i <= num_sides; i++) {
+        double a = 2.0 * M_PI * (i % num_sides) / num_sides;
+        c.append(center + Point(radius * cos(a), radius * sin(a)));
+    }
+}
+
+// how CurveIntersections used to work: every span of the curve against every span of the area
+static void bruteForceCurveIntersections(const CArea& a, const CCurve& curve, std::list<Point>& pts) {
+    std::list<Span> spans;
+    curve.GetSpans(spans);
+    for (auto& span : spans) {
+        std::list<Point> pts2;
+        a.SpanIntersections(span, pts2);
+        for (auto& pt : pts2) {
+            if (pts.size() == 0 || pt != pts.back()) pts.push_back(pt);
+        }
+    }
+}
+
+static void benchIntersections() {
+    CArea part = makePart(10, 10);
+    CCurve dense;
+    makePolygon(dense, Point(200, 200), 150.0, 20000);
+    part.append(dense);
+
+    // a zig-zag across the whole part
+    CCurve zig;
+    CBox2D box;
+    part.GetBox(box);
+    for (int i = 0; i <= 200; i++) {
+        double x = box.MinX() + box.Width() * i / 200.0;
+        zig.append(Point(x, (i % 2) ? box.MaxY() : box.MinY()));
+    }
+
+    size_t num_spans = 0;
+    for (const auto& c : part.m_curves) num_spans += c.m_vertices.size() - 1;
+
+    Timer tb;
+    std::list<Point> brute_pts;
+    bruteForceCurveIntersections(part, zig, brute_pts);
+    double brute_ms = tb.ms();
+
+    Timer tt;
+    std::list<Point> tree_pts;
+    part.CurveIntersections(zig, tree_pts);
+    double tree_ms = tt.ms();
+
+    bool same = (brute_pts.size() == tree_pts.size());
+    if (same) {
+        auto it = brute_pts.begin();
+        for (const auto& p : tree_pts) {
+            if (p != *it) same = false;
+            it++;
+        }
+    }
+
+    printf("intersections: %lu curve spans against %lu area spans, %lu crossings\n",
+           (unsigned long)(zig.m_vertices.size() - 1), (unsigned long)num_spans, (unsigned long)tree_pts.size());
+    printf("  every span     %.1f ms\n", brute_ms);
+    printf("  box tree       %.1f ms (%s)\n", tree_ms, same ? "same points, same order" : "DIFFERENT");
+}
+
+// what Span::Intersect used to do, through the kurve library
+static geoff_geometry::Span kurveSpan(const Span& span) {
+    return geoff_geometry::Span(span.m_v.m_type, geoff_geometry::Point(span.m_p.x, span.m_p.y),
+                                geoff_geometry::Point(span.m_v.m_p.x, span.m_v.m_p.y),
+                                geoff_geometry::Point(span.m_v.m_c.x, span.m_v.m_c.y));
+}
+
+static void kurveIntersect(const Span& s0, const Span& s1, std::list<Point>& pts) {
+    geoff_geometry::Point pInt1, pInt2;
+    double t[4];
+    int num_int = kurveSpan(s0).Intof(kurveSpan(s1), pInt1, pInt2, t);
+    if (num_int > 0) pts.push_back(Point(pInt1.x, pInt1.y));
+    if (num_int > 1) pts.push_back(Point(pInt2.x, pInt2.y));
+}
+
+static std::vector<Span> randomSpans(size_t n, bool arcs, Random& r) {
+    std::vector<Span> spans;
+    for (size_t i = 0; i < n; i++) {
+        Point s(r.next(0, 100), r.next(0, 100));
+        if (arcs && (i % 2)) {
+            Point c = s + Point(r.next(-20, 20), r.next(-20, 20));
+            double radius = s.dist(c);
+            double a = r.next(0, 2 * M_PI);
+            Point e = c + Point(radius * cos(a), radius * sin(a));
+            spans.push_back(Span(s, CVertex((i % 4 == 1) ? CVertex::vt_ccw_arc : CVertex::vt_cw_arc, e, c)));
+        } else {
+            spans.push_back(Span(s, CVertex(Point(r.next(0, 100), r.next(0, 100)))));
+        }
+    }
+    return spans;
+}
+
+static void benchSpanIntersect() {
+    Random r;
+    const size_t n = 1000;
+    for (int arcs = 0; arcs < 2; arcs++) {
+        std::vector<Span> spans = randomSpans(n, arcs != 0, r);
+
+        std::list<Point> kurve_pts, native_pts, batch_pts;
+        Timer tk;
+        for (const auto& s0 : spans)
+            for (const auto& s1 : spans) kurveIntersect(s0, s1, kurve_pts);
+        double kurve_ms = tk.ms();
+
+        Timer tn;
+        for (const auto& s0 : spans)
+            for (const auto& s1 : spans) s0.Intersect(s1, native_pts);
+        double native_ms = tn.ms();
+
+        Timer tb;
+        for (const auto& s0 : spans) s0.Intersect(spans.data(), spans.size(), batch_pts);
+        double batch_ms = tb.ms();
+
+        size_t differ = 0;
+        auto kit = kurve_pts.begin();
+        for (const auto& p : native_pts) {
+            if (kit == kurve_pts.end()) break;
+            if (p != *kit) differ++;
+            kit++;
+        }
+
+        double pairs = double(n) * n;
+        printf("span intersect, %s: %.0f pairs, %lu points (kurve %lu, batch %lu, %lu differ)\n",
+               arcs ? "lines and arcs" : "lines", pairs, (unsigned long)native_pts.size(),
+               (unsigned long)kurve_pts.size(), (unsigned long)batch_pts.size(), (unsigned long)differ);
+        printf("  kurve   %.1f ns/pair\n", kurve_ms * 1.0e6 / pairs);
+        printf("  native  %.1f ns/pair\n", native_ms * 1.0e6 / pairs);
+        printf("  batch   %.1f ns/pair\n", batch_ms * 1.0e6 / pairs);
+    }
+}
+
+// times and allocations of a few everyday operations, on curves with many vertices
+static void benchCurves() {
+    CCurve big;
+    makePolygon(big, Point(0, 0), 100.0, 100000);
+
+    auto report = [](const char* name, int repeats, const std::function<void()>& f) {
+        unsigned long allocations = num_allocations;
+        Timer t;
+        for (int i = 0; i < repeats; i++) f();
+        double ms = t.ms() / repeats;
+        printf("  %-22s %9.3f ms %10lu allocations\n", name, ms, (num_allocations - allocations) / repeats);
+    };
+
+    printf("curves: %lu vertices\n", (unsigned long)big.m_vertices.size());
+    double total = 0.0;
+    CBox2D box;
+    report("GetArea", 20, [&] { total += big.GetArea(); });
+    report("GetBox", 20, [&] { big.GetBox(box); });
+    report("Perim", 20, [&] { total += big.Perim(); });
+    report("copy", 20, [&] { CCurve c = big; total += c.m_vertices.back().m_p.x; });
+    report("Reverse", 20, [&] { big.Reverse(); });
+
+    CCurve polygon;
+    makePolygon(polygon, Point(0, 0), 100.0, 10000);
+    report("CCurve::Offset", 5, [&] { CCurve c = polygon; c.Offset(1.0, ACCURACY); total += c.m_vertices.size(); });
+
+    CArea part = makePart(20, 20);
+    report("CArea::Offset", 5, [&] { CArea a = part; a.Offset(1.0); total += a.m_curves.size(); });
+    CArea holes(ACCURACY);
+    for (int i = 0; i < 20; i++) {
+        CCurve c;
+        makeCircle(c, Point(40.0 * i + 30.0, 400.0), 15.0);
+        holes.append(c);
+    }
+    report("Subtract", 5, [&] { CArea a = part; a.Subtract(holes); total += a.m_curves.size(); });
+    report("Union", 5, [&] { CArea a = part; a.Union(holes); total += a.m_curves.size(); });
+
+    CArea small_part = makePart(4, 3);
+    CAreaPocketParams params(3.0, 0.0, 2.5, false, PocketMode::Spiral, 0.0);
+    report("pocket", 1, [&] {
+        std::list<CCurve> toolpath;
+        small_part.SplitAndMakePocketToolpath(toolpath, params);
+        total += toolpath.size();
+    });
+    if (total == 0.0) printf("  (nothing made)\n");
+}
+
+// a long toolpath of lines and arcs, a row of slots linked by lines
+static void makeToolpath(CCurve& c, int num_slots) {
+    c.append(Point(0, 0));
+    for (int i = 0; i < num_slots; i++) {
+        double x = i * 3.0;
+        c.append(Point(x, 10.0));
+        c.append(CVertex(CVertex::vt_cw_arc, Point(x + 1.0, 10.0), Point(x + 0.5, 10.0)));
+        c.append(Point(x + 1.0, 0.0));
+        c.append(CVertex(CVertex::vt_ccw_arc, Point(x + 3.0, 0.0), Point(x + 2.0, 0.3)));
+    }
+}
+
+static void benchBulge() {
+    CCurve curve;
+    makeToolpath(curve, 250000);
+    CBulgeCurve bulge_curve(curve);
+    size_t n = curve.m_vertices.size();
+
+    printf("bulge: %lu vertices\n", (unsigned long)n);
+    printf("  CCurve       %5.1f bytes per vertex\n", double(curve.m_vertices.capacity() * sizeof(CVertex)) / n);
+    printf("  CBulgeCurve  %5.1f bytes per vertex\n", double(bulge_curve.MemoryUsed()) / n);
+
+    Timer ta;
+    double area = curve.GetArea();
+    double perim = curve.Perim();
+    double ms = ta.ms();
+    Timer tb;
+    double bulge_area = bulge_curve.GetArea();
+    double bulge_perim = bulge_curve.Perim();
+    double bulge_ms = tb.ms();
+    printf("  GetArea and Perim: CCurve %.2f ms, CBulgeCurve %.2f ms (area %.6f / %.6f, perim %.6f / %.6f)\n", ms, bulge_ms, area,
+           bulge_area, perim, bulge_perim);
+
+    Timer tu;
+    CCurve unfitted = curve;
+    unfitted.UnFitArcs(ACCURACY);
+    double unfit_ms = tu.ms();
+    Timer tt;
+    std::vector<Point> pts;
+    bulge_curve.Tessellate(ACCURACY, pts);
+    double tessellate_ms = tt.ms();
+    printf("  UnFitArcs %.1f ms (%lu points), Tessellate %.1f ms (%lu points)\n", unfit_ms,
+           (unsigned long)unfitted.m_vertices.size(), tessellate_ms, (unsigned long)pts.size());
+
+    Timer tc;
+    CCurve back;
+    bulge_curve.ToCurve(back);
+    double to_curve_ms = tc.ms();
+    double worst = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        worst = std::max(worst, back.m_vertices[i].m_p.dist(curve.m_vertices[i].m_p));
+        if (curve.m_vertices[i].m_type) worst = std::max(worst, back.m_vertices[i].m_c.dist(curve.m_vertices[i].m_c));
+    }
+    printf("  round trip in %.1f ms, furthest centre or point moved %g\n", to_curve_ms, worst);
+}
+
+// FitArcs on dense points, from 1k to 1M of them; stops growing a shape once it takes over two seconds
+static void benchFitArcs() {
+    struct Shape {
+        const char* name;
+        std::function<void(CCurve&, int)> make;
+    };
+    std::vector<Shape> shapes = {
+        // big enough that a million points are still further apart than Point::tolerance
+        {"circle", [](CCurve& c, int n) { makePolygon(c, Point(0, 0), 5000.0, n); }},
+        {"rectangle", [](CCurve& c, int n) {
+             // a rectangle with every side split into many collinear points
+             Point corners[5] = {Point(0, 0), Point(10000, 0), Point(10000, 6000), Point(0, 6000), Point(0, 0)};
+             for (int side = 0; side < 4; side++) {
+                 for (int i = 0; i < n / 4; i++) c.append(corners[side] + (corners[side + 1] - corners[side]) * (double(i) / (n / 4)));
+             }
+             c.append(corners[4]);
+         }},
+        {"wavy", [](CCurve& c, int n) {
+             // a wave of 120 degree arcs, flattened, as booleans give back
+             const int num_arcs = 200;
+             const double radius = 5.0;
+             const double half_chord = radius * sin(M_PI / 3);
+             int points_per_arc = std::max(2, n / num_arcs);
+             c.append(Point(0, 0));
+             for (int a = 0; a < num_arcs; a++) {
+                 double side = (a % 2) ? 1.0 : -1.0;
+                 Point centre(half_chord * (2 * a + 1), side * radius * cos(M_PI / 3));
+                 double start = atan2(-centre.y, -half_chord);
+                 for (int i = 1; i <= points_per_arc; i++) {
+                     double angle = start + side * (2 * M_PI / 3) * i / points_per_arc;
+                     c.append(centre + Point(radius * cos(angle), radius * sin(angle)));
+                 }
+             }
+         }},
+    };
+
+    for (const auto& shape : shapes) {
+        for (int n = 1000; n <= 1000000; n *= 10) {
+            CCurve c;
+            shape.make(c, n);
+            size_t num_in = c.m_vertices.size();
+            Timer t;
+            c.FitArcs(ACCURACY);
+            double ms = t.ms();
+            printf("fit-arcs: %-9s %8lu points -> %6lu vertices in %9.2f ms\n", shape.name, (unsigned long)num_in,
+                   (unsigned long)c.m_vertices.size(), ms);
+            if (ms > 2000.0) break;
+        }
+    }
+}
+
+// PerimToPoint as it was, walking from the start every time
+static Point walkPerimToPoint(const CCurve& c, double perim) {
+    const Point* prev_p = nullptr;
+    double kperim = 0.0;
+    for (const auto& vertex : c.m_vertices) {
+        if (prev_p) {
+            Span span(*prev_p, vertex);
+            double length = span.Length();
+            if (perim < kperim + length) return span.MidPerim(perim - kperim);
+            kperim += length;
+        }
+        prev_p = &(vertex.m_p);
+    }
+    return c.m_vertices.back().m_p;
+}
+
+// sampling a long toolpath at many perimeter positions
+static void benchPerim() {
+    CCurve c;
+    makeToolpath(c, 2000);
+    const int num_samples = 10000;
+    double perim = c.Perim();
+    printf("perim: %lu vertices, %d samples\n", (unsigned long)c.m_vertices.size(), num_samples);
+
+    Timer tw;
+    std::vector<Point> walked;
+    for (int k = 0; k < num_samples; k++) walked.push_back(walkPerimToPoint(c, perim * k / (num_samples - 1)));
+    double walk_ms = tw.ms();
+
+    Timer ti;
+    std::vector<Point> single;
+    for (int k = 0; k < num_samples; k++) single.push_back(c.PerimToPoint(perim * k / (num_samples - 1)));
+    double single_ms = ti.ms();
+
+    Timer tb;
+    std::vector<Point> batch;
+    c.PerimToPoints(num_samples, batch);
+    double batch_ms = tb.ms();
+
+    double worst = 0.0;
+    for (int k = 0; k < num_samples; k++) {
+        worst = std::max(worst, walked[k].dist(single[k]));
+        worst = std::max(worst, walked[k].dist(batch[k]));
+    }
+    printf("  walking %.1f ms, PerimToPoint %.1f ms, PerimToPoints %.2f ms, furthest apart %g\n", walk_ms, single_ms,
+           batch_ms, worst);
+}
+
+// the furthest apart two curves' vertices are, or -1 if they have different spans
+static double curveDifference(const CCurve& a, const CCurve& b) {
+    if (a.m_vertices.size() != b.m_vertices.size()) return -1.0;
+    double worst = 0.0;
+    for (size_t i = 0; i < a.m_vertices.size(); i++) {
+        const CVertex& va = a.m_vertices[i];
+        const CVertex& vb = b.m_vertices[i];
+        if (va.m_type != vb.m_type) return -1.0;
+        worst = std::max(worst, va.m_p.dist(vb.m_p));
+        if (va.m_type) worst = std::max(worst, va.m_c.dist(vb.m_c));
+    }
+    return worst;
+}
+
+// CCurve::Offset against the Kurve offset it used to be, on part outlines, holes, a long toolpath and spiky shapes
+static void benchOffset() {
+    std::vector<CCurve> curves;
+    CArea part = makePart(10, 10);
+    for (const auto& c : part.m_curves) curves.push_back(c);
+    CCurve toolpath;
+    makeToolpath(toolpath, 200);
+    curves.push_back(toolpath);
+    Random r;
+    for (int i = 0; i < 50; i++) {
+        // a star, with loops for the offset to remove
+        CCurve star;
+        int num_points = 5 + i % 20;
+        for (int j = 0; j <= num_points; j++) {
+            double angle = 2 * M_PI * (j % num_points) / num_points;
+            double radius = (j % 2) ? r.next(2.0, 10.0) : r.next(10.0, 30.0);
+            star.append(Point(radius * cos(angle), radius * sin(angle)));
+        }
+        curves.push_back(star);
+    }
+    const double offsets[] = {-5.0, -2.0, -0.5, 0.5, 2.0, 5.0};
+
+    size_t num_cases = 0, num_same = 0, num_different = 0, num_both_failed = 0, num_kurve_failed = 0, num_direct_failed = 0;
+    double worst = 0.0;
+    double direct_ms = 0.0, kurve_ms = 0.0;
+    for (const auto& curve : curves) {
+        for (double offset : offsets) {
+            num_cases++;
+            CCurve direct = curve;
+#ifdef AREA_COUNTERS
+            unsigned long direct_before = CCurve::counters.offsets_direct.load();
+#endif
+            Timer td;
+            bool direct_ok = direct.Offset(offset, ACCURACY);
+            direct_ms += td.ms();
+#ifdef AREA_COUNTERS
+            // not when Offset fell back to the Kurve offset
+            direct_ok = direct_ok && CCurve::counters.offsets_direct.load() > direct_before;
+#endif
+
+            CCurve kurve = curve;
+            Timer tk;
+            bool kurve_ok = kurve.KurveOffset(offset);
+            kurve_ms += tk.ms();
+
+            if (direct_ok && kurve_ok) {
+                double d = curveDifference(direct, kurve);
+                if (d < 0.0 || d > 1.0e-9) num_different++;
+                else num_same++;
+                if (d > worst) worst = d;
+            }
+            else if (!direct_ok && !kurve_ok) num_both_failed++;
+            else if (direct_ok) num_kurve_failed++;
+            else num_direct_failed++;
+        }
+    }
+    printf("offset: %lu cases, direct %.1f ms, through Kurve %.1f ms\n", (unsigned long)num_cases, direct_ms, kurve_ms);
+    printf("  same %lu, different %lu (furthest %g), both failed %lu, only Kurve failed %lu, only direct failed %lu\n",
+           (unsigned long)num_same, (unsigned long)num_different, worst, (unsigned long)num_both_failed,
+           (unsigned long)num_kurve_failed, (unsigned long)num_direct_failed);
+#ifndef AREA_COUNTERS
+    printf("  built without AREA_COUNTERS, so offsets that fell back to Kurve count as direct\n");
+#endif
+}
+
+// a part as it might come from a scan or a flattened spline; tens of thousands of points, a little noise on each
+static CArea makeDensePart(int num_points) {
+    CArea part(ACCURACY);
+    Random r;
+    CCurve outline;
+    for (int i = 0; i <= num_points; i++) {
+        double angle = 2 * M_PI * (i % num_points) / num_points;
+        double radius = 60.0 + 8.0 * sin(5 * angle) + r.next(-0.1, 0.1) * ACCURACY;
+        outline.append(Point(radius * cos(angle), 0.7 * radius * sin(angle)));
+    }
+    part.append(outline);
+    for (int h = 0; h < 3; h++) {
+        CCurve hole;
+        Point centre(-25.0 + 25.0 * h, 0.0);
+        int num_hole_points = num_points / 8;
+        for (int i = 0; i <= num_hole_points; i++) {
+            double angle = -2 * M_PI * (i % num_hole_points) / num_hole_points;
+            double radius = 6.0 + r.next(-0.1, 0.1) * ACCURACY;
+            hole.append(centre + Point(radius * cos(angle), radius * sin(angle)));
+        }
+        part.append(hole);
+    }
+    return part;
+}
+
+// pocketing a dense part with and without simplifying what goes to clipper
+static void benchSimplify() {
+    CArea part = makeDensePart(4000);
+
+    Timer ts;
+    CArea simplified = part;
+    simplified.Simplify(ACCURACY);
+    double simplify_ms = ts.ms();
+    double worst = 0.0;
+    auto it = simplified.m_curves.begin();
+    for (const auto& c : part.m_curves) {
+        for (const auto& v : c.m_vertices) worst = std::max(worst, it->NearestPoint(v.m_p, ACCURACY).dist(v.m_p));
+        it++;
+    }
+    printf("simplify: %lu vertices -> %lu in %.1f ms, furthest old vertex from new curve %g (tolerance %g)\n",
+           (unsigned long)numVertices(part), (unsigned long)numVertices(simplified), simplify_ms, worst, ACCURACY);
+
+    CAreaPocketParams params(3.0, 0.0, 2.5, false, PocketMode::Spiral, 0.0);
+    for (int simplify = 0; simplify < 2; simplify++) {
+        CAreaProcessingContext ctx;
+        ctx.simplify_before_booleans = (simplify != 0);
+        Timer t;
+        std::list<CCurve> toolpath;
+        part.SplitAndMakePocketToolpath(toolpath, params, &ctx);
+        double ms = t.ms();
+        size_t n = 0;
+        double length = 0.0;
+        for (const auto& c : toolpath) {
+            n += c.m_vertices.size();
+            length += c.Perim();
+        }
+        printf("  pocket %s: %.1f ms, %lu curves, %lu vertices, length %.3f\n", simplify ? "simplified" : "as it is",
+               ms, (unsigned long)toolpath.size(), (unsigned long)n, length);
+    }
+}
+
+// whole-curve span routines on a polyline, recomputed each time
+static void benchPolyline() {
+    CCurve c;
+    makePolygon(c, Point(0, 0), 100.0, 200000);
+    const int reps = 20;
+    printf("polyline: %lu vertices\n", (unsigned long)c.m_vertices.size());
+
+    double sum = 0.0;
+    Timer ta;
+    for (int i = 0; i < reps; i++) sum += c.GetArea();
+    double area_ms = ta.ms() / reps;
+
+    Timer tb;
+    for (int i = 0; i < reps; i++) {
+        CBox2D box;
+        c.GetBox(box);
+        sum += box.Width();
+    }
+    double box_ms = tb.ms() / reps;
+
+    Timer tp;
+    for (int i = 0; i < reps; i++) sum += c.Perim();
+    double perim_ms = tp.ms() / reps;
+
+    Timer tn;
+    for (int i = 0; i < reps; i++) sum += c.NearestPoint(Point(i * 7.0, 150.0 - i * 11.0), ACCURACY).x;
+    double near_ms = tn.ms() / reps;
+
+    CArea a(ACCURACY), b(ACCURACY);
+    a.append(c);
+    CCurve c2;
+    makePolygon(c2, Point(50, 0), 100.0, 200000);
+    b.append(c2);
+    Timer tu;
+    a.Union(b);
+    double union_ms = tu.ms();
+
+    printf("  GetArea %.3f ms, GetBox %.3f ms, Perim %.3f ms, NearestPoint %.3f ms, Union %.1f ms (%g)\n", area_ms, box_ms,
+           perim_ms, near_ms, union_ms, sum);
+}
+
+static bool sameCurves(const CArea& a, const CArea& b) {
+    if (a.m_curves.size() != b.m_curves.size()) return false;
+    auto it = b.m_curves.begin();
+    for (const auto& c : a.m_curves) {
+        const CCurve& c2 = *it++;
+        if (c.m_vertices.size() != c2.m_vertices.size()) return false;
+        for (size_t i = 0; i < c.m_vertices.size(); i++) {
+            const CVertex& v = c.m_vertices[i];
+            const CVertex& v2 = c2.m_vertices[i];
+            if (v.m_type != v2.m_type || v.m_p != v2.m_p || (v.m_type && v.m_c != v2.m_c)) return false;
+        }
+    }
+    return true;
+}
+
+// cutting more and more holes in a plate, fitting arcs to the result's curves in one thread, then in several
+static void benchFitThreads() {
+    unsigned num_threads = std::max(2u, std::thread::hardware_concurrency());
+    for (int n : {2, 5, 10, 20, 40}) {
+        CArea plate(ACCURACY);
+        CCurve outline;
+        makeRect(outline, Point(0, 0), 40.0 * n + 20.0, 40.0 * n + 20.0);
+        plate.append(outline);
+        CArea holes(ACCURACY);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                CCurve hole;
+                makeCircle(hole, Point(30.0 + 40.0 * i, 30.0 + 40.0 * j), 6.0 + (i + j) % 3);
+                holes.append(hole);
+            }
+        }
+
+        double ms[2];
+        CArea results[2] = {CArea(ACCURACY), CArea(ACCURACY)};
+        for (int threaded = 0; threaded < 2; threaded++) {
+            CAreaProcessingContext ctx;
+            ctx.fit_arcs_threads = threaded ? num_threads : 1;
+            const int reps = 5;
+            Timer t;
+            for (int r = 0; r < reps; r++) {
+                results[threaded] = plate;
+                results[threaded].Subtract(holes, &ctx);
+            }
+            ms[threaded] = t.ms() / reps;
+        }
+        printf("fit-threads: %4d holes -> %4lu curves, %6lu vertices: one thread %7.2f ms, %u threads %7.2f ms%s\n", n * n,
+               (unsigned long)results[1].m_curves.size(), (unsigned long)numVertices(results[1]), ms[0], num_threads, ms[1],
+               sameCurves(results[0], results[1]) ? "" : " DIFFERENT");
+    }
+}
+
+// the old offset path, MakeKurve + Kurve::OffsetMethod1 + MakeCCurve, on long toolpaths and a dense polygon
+static void benchKurve() {
+    for (int n : {1000, 10000, 50000, 200000}) {
+        CCurve toolpath;
+        makeToolpath(toolpath, n / 4);
+        CCurve polygon;
+        makePolygon(polygon, Point(0, 0), 1000.0, n);
+        const CCurve* curves[] = {&toolpath, &polygon};
+        const char* names[] = {"toolpath", "polygon"};
+        for (int i = 0; i < 2; i++) {
+            CCurve c = *curves[i];
+            unsigned long allocations_before = num_allocations.load();
+            Timer t;
+            bool ok = c.KurveOffset(0.2);
+            double ms = t.ms();
+            unsigned long allocations = num_allocations.load() - allocations_before;
+            double sum = 0.0;
+            for (const auto& v : c.m_vertices) sum += v.m_p.x + v.m_p.y;
+            printf("kurve: %-8s %7lu vertices -> %7lu in %8.2f ms, %7lu allocations%s (%.6f)\n", names[i],
+                   (unsigned long)curves[i]->m_vertices.size(), (unsigned long)c.m_vertices.size(), ms, allocations,
+                   ok ? "" : " FAILED", sum);
+        }
+    }
+}
+
+// slots whose arcs have slightly different radii at their ends, as from a DXF with rounded coordinates;
+// the direct offset and the kurve offset both refuse them, so CCurve::Offset ends up offsetting an area
+static void benchKurveErrors() {
+    std::vector<CCurve> curves;
+    Random r;
+    for (int i = 0; i < 200; i++) {
+        // a slot, its arc centres a little off the middle
+        double length = r.next(5.0, 50.0), radius = r.next(1.0, 5.0);
+        CCurve c;
+        c.append(Point(0, 0));
+        c.append(Point(length, 0));
+        c.append(CVertex(CVertex::vt_ccw_arc, Point(length, 2 * radius), Point(length, radius + r.next(1.0e-5, 1.0e-3))));
+        c.append(Point(0, 2 * radius));
+        c.append(CVertex(CVertex::vt_ccw_arc, Point(0, 0), Point(0, radius - r.next(1.0e-5, 1.0e-3))));
+        curves.push_back(c);
+    }
+    const double offsets[] = {-0.5, -0.2, 0.2};
+
+#ifdef AREA_COUNTERS
+    CCurve::counters.Reset();
+#endif
+    size_t num_failed = 0;
+    Timer tk;
+    for (const auto& curve : curves) {
+        for (double offset : offsets) {
+            CCurve c = curve;
+            if (!c.KurveOffset(offset)) num_failed++;
+        }
+    }
+    double kurve_ms = tk.ms();
+#ifdef AREA_COUNTERS
+    unsigned long exceptions = CCurve::counters.kurve_exceptions.load();
+#endif
+
+    Timer to;
+    size_t num_offset = 0;
+    for (const auto& curve : curves) {
+        for (double offset : offsets) {
+            CCurve c = curve;
+            if (c.Offset(offset, ACCURACY)) num_offset++;
+        }
+    }
+    double offset_ms = to.ms();
+    size_t num_cases = curves.size() * 3;
+    printf("kurve-errors: %lu offsets, KurveOffset failed %lu, %.3f ms each\n", (unsigned long)num_cases,
+           (unsigned long)num_failed, kurve_ms / num_cases);
+    printf("  CCurve::Offset %.3f ms each, %lu succeeded\n", offset_ms / num_cases, (unsigned long)num_offset);
+#ifdef AREA_COUNTERS
+    printf("  %lu exceptions from the Kurve code, %lu offsets by area\n", exceptions,
+           CCurve::counters.offsets_by_area.load());
+#endif
+}
+
+// writes a DXF of lines, arcs and LWPOLYLINEs, about num_mb MB
+static void writeDxf(const char* path, int num_mb) {
+    FILE* f = fopen(path, "w");
+    if (!f) return;
+    fprintf(f, "  0\nSECTION\n  2\nHEADER\n  9\n$INSUNITS\n 70\n4\n  0\nENDSEC\n");
+    fprintf(f, "  0\nSECTION\n  2\nENTITIES\n");
+    Random r;
+    long size_wanted = num_mb * 1000000L;
+    while (ftell(f) < size_wanted) {
+        double x = r.next(0.0, 1000.0), y = r.next(0.0, 1000.0);
+        fprintf(f, "  0\nLINE\n  8\nlayer%d\n 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 11\n%.10g\n 21\n%.10g\n 31\n0.0\n",
+                int(r.next(0.0, 10.0)), x, y, x + 10.0, y);
+        fprintf(f, "  0\nARC\n  8\nlayer0\n 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 40\n5.0\n 50\n0.0\n 51\n90.0\n", x + 10.0,
+                y + 5.0);
+        fprintf(f, "  0\nLWPOLYLINE\n  8\nlayer1\n 90\n4\n 70\n1\n");
+        for (int i = 0; i < 4; i++) {
+            fprintf(f, " 10\n%.10g\n 20\n%.10g\n", x + 20.0 + (i == 1 || i == 2) * 5.0, y + (i >= 2) * 5.0);
+            if (i == 1) fprintf(f, " 42\n0.4142135624\n");
+        }
+    }
+    fprintf(f, "  0\nENDSEC\n  0\nEOF\n");
+    fclose(f);
+}
+
+// counts what CDxfRead finds, to time the reading on its own
+class CountingDxfRead : public CDxfRead {
+public:
+    size_t num_lines = 0, num_arcs = 0;
+    double sum = 0.0;
+    CountingDxfRead(const char* filepath) : CDxfRead(filepath) {}
+    void OnReadLine(const double* s, const double* e) override {
+        num_lines++;
+        sum += s[0] + e[1];
+    }
+    void OnReadArc(const double* s, const double* e, const double* c, bool dir) override {
+        num_arcs++;
+        sum += c[0];
+    }
+};
+
+static long fileSize(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+// CDxfRead and AreaDxfRead speed, in MB/s
+static void benchDxf() {
+    const char* path = "area-bench.dxf";
+    for (int mb : {5, 50}) {
+        writeDxf(path, mb);
+        double file_mb = fileSize(path) / 1.0e6;
+
+        Timer t;
+        CountingDxfRead reader(path);
+        reader.DoRead();
+        double read_ms = t.ms();
+
+        CArea area(ACCURACY);
+        Timer ta;
+        {
+            AreaDxfRead area_reader(&area, path);
+            area_reader.DoRead();
+        }
+        double area_ms = ta.ms();
+
+        printf("dxf: %6.1f MB, %lu lines, %lu arcs: CDxfRead %7.1f MB/s, AreaDxfRead %7.1f MB/s, %lu curves (%.3f)\n", file_mb,
+               (unsigned long)reader.num_lines, (unsigned long)reader.num_arcs, file_mb / read_ms * 1000.0,
+               file_mb / area_ms * 1000.0, (unsigned long)area.m_curves.size(), reader.sum);
+    }
+    remove(path);
+}
+
+// reading a 200 MB file's ENTITIES section on more threads
+static void benchDxfThreads() {
+    const char* path = "area-bench.dxf";
+    writeDxf(path, 200);
+    double file_mb = fileSize(path) / 1.0e6;
+    unsigned int hardware_threads = std::thread::hardware_concurrency();
+    double first_sum = 0.0;
+    size_t first_curves = 0;
+    for (unsigned int num_threads : {1u, 2u, 4u, 8u}) {
+        Timer t;
+        CountingDxfRead reader(path);
+        reader.SetReadThreads(num_threads);
+        reader.DoRead();
+        double read_ms = t.ms();
+
+        CArea area(ACCURACY);
+        Timer ta;
+        {
+            AreaDxfRead area_reader(&area, path);
+            area_reader.SetReadThreads(num_threads);
+            area_reader.DoRead();
+        }
+        double area_ms = ta.ms();
+
+        if (num_threads == 1) {
+            first_sum = reader.sum;
+            first_curves = area.m_curves.size();
+        }
+        printf("dxf-threads: %6.1f MB, %u threads (%u hardware): CDxfRead %7.1f MB/s, AreaDxfRead %7.1f MB/s%s\n", file_mb,
+               num_threads, hardware_threads, file_mb / read_ms * 1000.0, file_mb / area_ms * 1000.0,
+               (reader.sum == first_sum && area.m_curves.size() == first_curves) ? "" : " DIFFERENT");
+    }
+    remove(path);
+}
+
+// writes num_shapes slots, as LINEs and ARCs, in a random order, with some lines the other way round
+static void writeShuffledDxf(const char* path, int num_shapes, bool shuffle) {
+    Random r, order(54321);
+    std::vector<std::string> entities;
+    char buf[512];
+    for (int i = 0; i < num_shapes; i++) {
+        double x = (i % 100) * 30.0, y = (i / 100) * 30.0;
+        double length = r.next(5.0, 20.0), radius = r.next(1.0, 5.0);
+        Point p[4] = {Point(x, y), Point(x + length, y), Point(x + length, y + 2 * radius), Point(x, y + 2 * radius)};
+        for (int k = 0; k < 4; k += 2) {
+            const Point& s = p[k];
+            const Point& e = p[k + 1];
+            bool reverse = shuffle && order.next(0.0, 1.0) < 0.5;
+            const Point& a = reverse ? e : s;
+            const Point& b = reverse ? s : e;
+            snprintf(buf, sizeof(buf), "  0\nLINE\n  8\n0\n 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 11\n%.10g\n 21\n%.10g\n 31\n0.0\n", a.x, a.y,
+                     b.x, b.y);
+            entities.push_back(buf);
+            Point c = (k == 0) ? Point(x + length, y + radius) : Point(x, y + radius);
+            snprintf(buf, sizeof(buf), "  0\nARC\n  8\n0\n 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 40\n%.10g\n 50\n%d\n 51\n%d\n", c.x, c.y,
+                     radius, (k == 0) ? 270 : 90, (k == 0) ? 90 : 270);
+            entities.push_back(buf);
+        }
+    }
+    if (shuffle) {
+        for (size_t i = entities.size() - 1; i > 0; i--) std::swap(entities[i], entities[(size_t)order.next(0.0, (double)i + 1)]);
+    }
+    FILE* f = fopen(path, "w");
+    if (!f) return;
+    fprintf(f, "  0\nSECTION\n  2\nENTITIES\n");
+    for (const auto& e : entities) fputs(e.c_str(), f);
+    fprintf(f, "  0\nENDSEC\n  0\nEOF\n");
+    fclose(f);
+}
+
+// AreaDxfRead on slots whose lines and arcs are in file order, then shuffled, with and without joining curves.
+// (CArea::Reorder is too slow on thousands of curves to time here)
+static void benchDxfJoin() {
+    const char* path = "area-bench.dxf";
+    for (int n : {1000, 10000, 50000}) {
+        for (bool shuffle : {false, true}) {
+            writeShuffledDxf(path, n, shuffle);
+            for (bool join : {false, true}) {
+                CArea area(ACCURACY);
+                Timer t;
+                size_t num_open;
+                {
+                    AreaDxfRead reader(&area, path);
+                    reader.m_join_curves = join;
+                    reader.DoRead();
+                    num_open = reader.NumOpenCurves();
+                }
+                double read_ms = t.ms();
+                double closed_area = 0.0;
+                for (const auto& c : area.m_curves) {
+                    if (c.IsClosed()) closed_area += fabs(c.GetArea());
+                }
+                printf("dxf-join: %5d slots, %-8s %-7s: %6lu curves, %6lu open, read %8.2f ms (area %.3f)\n", n,
+                       shuffle ? "shuffled" : "in order", join ? "joined" : "as read", (unsigned long)area.m_curves.size(),
+                       (unsigned long)num_open, read_ms, closed_area);
+            }
+        }
+    }
+    remove(path);
+}
+
+// CDxfWrite and CDxfRead on the same lines, arcs and circles, as a text DXF and as a binary one
+static void benchDxfBinary() {
+    const char* path = "area-bench.dxf";
+    for (int n : {20000, 200000}) {
+        for (bool binary : {false, true}) {
+            Random r;
+            Timer tw;
+            {
+                CDxfWrite writer(path, binary);
+                for (int i = 0; i < n; i++) {
+                    double x = r.next(0.0, 1000.0), y = r.next(0.0, 1000.0);
+                    double s[3] = {x, y, 0.0}, e[3] = {x + 10.0, y, 0.0}, c[3] = {x + 10.0, y + 5.0, 0.0};
+                    double a[3] = {x + 15.0, y + 5.0, 0.0};
+                    writer.WriteLine(s, e, "0");
+                    writer.WriteArc(e, a, c, true, "0");
+                    writer.WriteCircle(s, 2.5, "holes");
+                }
+            }
+            double write_ms = tw.ms();
+            double file_mb = fileSize(path) / 1.0e6;
+
+            Timer t;
+            CountingDxfRead reader(path);
+            reader.DoRead();
+            double read_ms = t.ms();
+
+            CArea area(ACCURACY);
+            Timer ta;
+            {
+                AreaDxfRead area_reader(&area, path);
+                area_reader.DoRead();
+            }
+            double area_ms = ta.ms();
+
+            printf("dxf-binary: %6d shapes, %-6s %6.1f MB: write %7.1f MB/s (%7.1f ms), CDxfRead %7.1f ms, AreaDxfRead %7.1f ms, "
+                   "%lu lines, %lu arcs, %lu curves (%.3f)\n",
+                   n, binary ? "binary" : "text", file_mb, file_mb / write_ms * 1000.0, write_ms, read_ms, area_ms,
+                   (unsigned long)reader.num_lines, (unsigned long)reader.num_arcs, (unsigned long)area.m_curves.size(), reader.sum);
+        }
+    }
+    remove(path);
+}
+
+// the toolpath's lines and arcs, written a group at a time with << endl, as CDxfWrite used to
+static void writeEndlDxf(const char* path, const CCurve& curve) {
+    std::ofstream ofs(path);
+    ofs << 0 << std::endl << "SECTION" << std::endl << 2 << std::endl << "ENTITIES" << std::endl;
+    const Point* prev_p = nullptr;
+    for (const auto& v : curve.m_vertices) {
+        if (prev_p) {
+            if (v.m_type == CVertex::vt_line) {
+                ofs << 0 << std::endl << "LINE" << std::endl << 8 << std::endl << "0" << std::endl;
+                ofs << 10 << std::endl << prev_p->x << std::endl << 20 << std::endl << prev_p->y << std::endl << 30 << std::endl << 0.0 << std::endl;
+                ofs << 11 << std::endl << v.m_p.x << std::endl << 21 << std::endl << v.m_p.y << std::endl << 31 << std::endl << 0.0 << std::endl;
+            } else {
+                double a0 = atan2(prev_p->y - v.m_c.y, prev_p->x - v.m_c.x) * 180 / M_PI;
+                double a1 = atan2(v.m_p.y - v.m_c.y, v.m_p.x - v.m_c.x) * 180 / M_PI;
+                if (v.m_type == CVertex::vt_cw_arc) std::swap(a0, a1);
+                ofs << 0 << std::endl << "ARC" << std::endl << 8 << std::endl << "0" << std::endl;
+                ofs << 10 << std::endl << v.m_c.x << std::endl << 20 << std::endl << v.m_c.y << std::endl << 30 << std::endl << 0.0 << std::endl;
+                ofs << 40 << std::endl << prev_p->dist(v.m_c) << std::endl << 50 << std::endl << a0 << std::endl << 51 << std::endl << a1 << std::endl;
+            }
+        }
+        prev_p = &v.m_p;
+    }
+    ofs << 0 << std::endl << "ENDSEC" << std::endl << 0 << std::endl << "EOF";
+}
+
+static double perim(const CArea& a) {
+    double p = 0.0;
+    for (const auto& c : a.m_curves) p += c.Perim();
+    return p;
+}
+
+// AreaDxfWrite on a long toolpath and on a part with many holes, as LINEs and ARCs, as LWPOLYLINEs, and binary,
+// each read back with AreaDxfRead to check the curves come back
+static void benchDxfWrite() {
+    const char* path = "area-bench.dxf";
+    CCurve toolpath;
+    makeToolpath(toolpath, 250000);
+    CArea toolpath_area(ACCURACY);
+    toolpath_area.append(toolpath);
+    CArea part = makePart(100, 100);
+
+    Timer te;
+    writeEndlDxf(path, toolpath);
+    double endl_ms = te.ms();
+    double endl_mb = fileSize(path) / 1.0e6;
+    printf("dxf-write: toolpath %7lu vertices, << endl LINE/ARC    %6.1f MB: write %7.1f MB/s (%7.1f ms)\n",
+           (unsigned long)toolpath.m_vertices.size(), endl_mb, endl_mb / endl_ms * 1000.0, endl_ms);
+
+    const char* names[] = {"toolpath", "part"};
+    const CArea* areas[] = {&toolpath_area, &part};
+    for (int k = 0; k < 2; k++) {
+        const CArea& area = *areas[k];
+        for (int mode = 0; mode < 3; mode++) {
+            bool binary = (mode == 2);
+            Timer t;
+            {
+                AreaDxfWrite writer(path, binary);
+                writer.m_polylines = (mode != 0);
+                writer.WriteArea(area);
+            }
+            double write_ms = t.ms();
+            double file_mb = fileSize(path) / 1.0e6;
+
+            CArea read_area(ACCURACY);
+            {
+                AreaDxfRead reader(&read_area, path);
+                reader.DoRead();
+            }
+            printf("dxf-write: %-8s %7lu vertices, %-6s %-10s %6.1f MB: write %7.1f MB/s (%7.1f ms), read back %lu curves, "
+                   "%lu vertices, perim %.3f (%.3f)\n",
+                   names[k], (unsigned long)numVertices(area), binary ? "binary" : "text", mode ? "LWPOLYLINE" : "LINE/ARC",
+                   file_mb, file_mb / write_ms * 1000.0, write_ms, (unsigned long)read_area.m_curves.size(),
+                   (unsigned long)numVertices(read_area), perim(read_area), perim(area));
+        }
+    }
+    remove(path);
+}
+
+// writes num_splines SPLINEs: circles as rational quadratic NURBS, or wavy cubic ones through a row of control points
+static void writeSplineDxf(const char* path, int num_splines, bool circles, std::vector<std::pair<Point, double>>& circle_list) {
+    FILE* f = fopen(path, "w");
+    if (!f) return;
+    fprintf(f, "  0\nSECTION\n  2\nENTITIES\n");
+    Random r;
+    for (int i = 0; i < num_splines; i++) {
+        double x = (i % 100) * 100.0, y = (i / 100) * 100.0;
+        fprintf(f, "  0\nSPLINE\n  8\n0\n");
+        if (circles) {
+            double radius = r.next(5.0, 40.0);
+            circle_list.push_back(std::make_pair(Point(x, y), radius));
+            const double knots[] = {0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 4};
+            const double px[] = {1, 1, 0, -1, -1, -1, 0, 1, 1}, py[] = {0, 1, 1, 1, 0, -1, -1, -1, 0};
+            fprintf(f, " 70\n11\n 71\n2\n 72\n12\n 73\n9\n");
+            for (double k : knots) fprintf(f, " 40\n%.17g\n", k);
+            for (int k = 0; k < 9; k++) {
+                fprintf(f, " 41\n%.17g\n", (k % 2) ? sqrt(0.5) : 1.0);
+                fprintf(f, " 10\n%.17g\n 20\n%.17g\n 30\n0\n", x + radius * px[k], y + radius * py[k]);
+            }
+        } else {
+            const int n = 24;
+            fprintf(f, " 70\n8\n 71\n3\n 72\n%d\n 73\n%d\n", n + 4, n);
+            for (int k = 0; k < n + 4; k++) fprintf(f, " 40\n%d\n", std::min(std::max(k - 3, 0), n - 3));
+            for (int k = 0; k < n; k++) {
+                fprintf(f, " 10\n%.17g\n 20\n%.17g\n 30\n0\n", x + k * 4.0, y + ((k % 2) ? 1.0 : -1.0) * r.next(1.0, 5.0));
+            }
+        }
+    }
+    fprintf(f, "  0\nENDSEC\n  0\nEOF\n");
+    fclose(f);
+}
+
+// the furthest a curve's vertices and span middles are from the circle
+static double circleError(const CCurve& c, const Point& centre, double radius) {
+    double error = 0.0;
+    const Point* prev_p = nullptr;
+    for (const auto& v : c.m_vertices) {
+        error = std::max(error, fabs(v.m_p.dist(centre) - radius));
+        if (prev_p) error = std::max(error, fabs(Span(*prev_p, v).MidParam(0.5).dist(centre) - radius));
+        prev_p = &v.m_p;
+    }
+    return error;
+}
+
+// AreaDxfRead on SPLINEs, fitted with lines or with arcs, within ACCURACY
+static void benchDxfSpline() {
+    const char* path = "area-bench.dxf";
+    const int n = 10000;
+    for (bool circles : {true, false}) {
+        std::vector<std::pair<Point, double>> circle_list;
+        writeSplineDxf(path, n, circles, circle_list);
+        for (bool arcs : {false, true}) {
+            CArea area(ACCURACY);
+            Timer t;
+            {
+                AreaDxfRead reader(&area, path);
+                reader.m_spline_arcs = arcs;
+                reader.DoRead();
+            }
+            double read_ms = t.ms();
+            size_t num_arcs = 0;
+            for (const auto& c : area.m_curves) {
+                for (const auto& v : c.m_vertices) num_arcs += (v.m_type != CVertex::vt_line);
+            }
+            printf("dxf-spline: %5d %-6s as %-5s: %8.1f vertices (%6.1f arcs) a spline, %6.2f us a spline, %lu curves", n,
+                   circles ? "circle" : "wavy", arcs ? "arcs" : "lines", (double)numVertices(area) / n, (double)num_arcs / n,
+                   read_ms * 1000.0 / n, (unsigned long)area.m_curves.size());
+            if (circles && area.m_curves.size() == circle_list.size()) {
+                double error = 0.0, uniform = 0.0;
+                size_t i = 0;
+                for (const auto& c : area.m_curves) {
+                    error = std::max(error, circleError(c, circle_list[i].first, circle_list[i].second));
+                    uniform += ceil(M_PI / acos(1.0 - ACCURACY / circle_list[i].second)) + 1;
+                    i++;
+                }
+                printf(", error %.5f (uniform chords would need %.1f vertices)", error, uniform / n);
+            }
+            printf("\n");
+        }
+    }
+    remove(path);
+}
+
+// writes a drawing on 10 layers, about num_mb MB, with its entities' handles and subclass markers before their layers,
+// as AutoCAD writes them, and BLOCKS and OBJECTS sections of about a fifth of the file each
+static void writeLayeredDxf(const char* path, int num_mb) {
+    FILE* f = fopen(path, "w");
+    if (!f) return;
+    fprintf(f, "  0\nSECTION\n  2\nHEADER\n  9\n$INSUNITS\n 70\n4\n  0\nENDSEC\n");
+    fprintf(f, "  0\nSECTION\n  2\nTABLES\n  0\nTABLE\n  2\nLAYER\n");
+    int handle = 0x100;
+    for (int i = 0; i < 10; i++) {
+        fprintf(f, "  0\nLAYER\n  5\n%X\n100\nAcDbSymbolTableRecord\n100\nAcDbLayerTableRecord\n  2\nlayer%d\n 70\n0\n 62\n%d\n",
+                handle++, i, i + 1);
+    }
+    fprintf(f, "  0\nENDTAB\n  0\nENDSEC\n");
+    Random r;
+    long size_wanted = num_mb * 1000000L;
+    fprintf(f, "  0\nSECTION\n  2\nBLOCKS\n");
+    for (int b = 0; ftell(f) < size_wanted / 5; b++) {
+        fprintf(f, "  0\nBLOCK\n  8\n0\n  2\nblock%d\n 70\n0\n 10\n0.0\n 20\n0.0\n 30\n0.0\n", b);
+        for (int i = 0; i < 20; i++) {
+            double x = r.next(0.0, 100.0), y = r.next(0.0, 100.0);
+            fprintf(f, "  0\nLINE\n  5\n%X\n330\n1F\n100\nAcDbEntity\n  8\nlayer%d\n100\nAcDbLine\n"
+                       " 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 11\n%.10g\n 21\n%.10g\n 31\n0.0\n",
+                    handle++, int(r.next(0.0, 10.0)), x, y, x + 1.0, y);
+        }
+        fprintf(f, "  0\nENDBLK\n  8\n0\n");
+    }
+    fprintf(f, "  0\nENDSEC\n  0\nSECTION\n  2\nENTITIES\n");
+    while (ftell(f) < size_wanted * 4 / 5) {
+        double x = r.next(0.0, 1000.0), y = r.next(0.0, 1000.0);
+        fprintf(f, "  0\nLINE\n  5\n%X\n330\n1F\n100\nAcDbEntity\n  8\nlayer%d\n100\nAcDbLine\n"
+                   " 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 11\n%.10g\n 21\n%.10g\n 31\n0.0\n",
+                handle++, int(r.next(0.0, 10.0)), x, y, x + 10.0, y);
+        fprintf(f, "  0\nARC\n  5\n%X\n330\n1F\n100\nAcDbEntity\n  8\nlayer%d\n100\nAcDbCircle\n"
+                   " 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 40\n5.0\n100\nAcDbArc\n 50\n0.0\n 51\n90.0\n",
+                handle++, int(r.next(0.0, 10.0)), x + 10.0, y + 5.0);
+        fprintf(f, "  0\nLWPOLYLINE\n  5\n%X\n330\n1F\n100\nAcDbEntity\n  8\nlayer%d\n100\nAcDbPolyline\n 90\n4\n 70\n1\n",
+                handle++, int(r.next(0.0, 10.0)));
+        for (int i = 0; i < 4; i++) {
+            fprintf(f, " 10\n%.10g\n 20\n%.10g\n", x + 20.0 + (i == 1 || i == 2) * 5.0, y + (i >= 2) * 5.0);
+            if (i == 1) fprintf(f, " 42\n0.4142135624\n");
+        }
+    }
+    fprintf(f, "  0\nENDSEC\n  0\nSECTION\n  2\nOBJECTS\n");
+    while (ftell(f) < size_wanted) {
+        fprintf(f, "  0\nXRECORD\n  5\n%X\n330\n1F\n100\nAcDbXrecord\n280\n1\n  1\nsome text\n 10\n%.10g\n 20\n%.10g\n"
+                   " 30\n0.0\n 40\n%.10g\n 70\n%d\n",
+                handle++, r.next(0.0, 1000.0), r.next(0.0, 1000.0), r.next(0.0, 10.0), int(r.next(0.0, 100.0)));
+    }
+    fprintf(f, "  0\nENDSEC\n  0\nEOF\n");
+    fclose(f);
+}
+
+// reading all of a 100 MB drawing, then one of its 10 layers, then that layer without the BLOCKS and OBJECTS sections
+static void benchDxfFilter() {
+    const char* path = "area-bench.dxf";
+    writeLayeredDxf(path, 100);
+    double file_mb = fileSize(path) / 1.0e6;
+    const std::vector<std::string> one_layer = {"layer3"};
+    struct Filter {
+        const char* name;
+        const std::vector<std::string>* layers;
+        bool entities_only;
+    } filters[] = {{"everything", nullptr, false}, {"one layer", &one_layer, false}, {"one layer, entities only", &one_layer, true}};
+    for (const auto& filter : filters) {
+        Timer t;
+        CountingDxfRead reader(path);
+        if (filter.layers) reader.SetLayerFilter(*filter.layers);
+        reader.SetEntitiesOnly(filter.entities_only);
+        reader.DoRead();
+        double read_ms = t.ms();
+
+        CArea area(ACCURACY);
+        Timer ta;
+        {
+            AreaDxfRead area_reader(&area, path);
+            if (filter.layers) area_reader.SetLayerFilter(*filter.layers);
+            area_reader.SetEntitiesOnly(filter.entities_only);
+            area_reader.DoRead();
+        }
+        double area_ms = ta.ms();
+
+        printf("dxf-filter: %6.1f MB, %-24s: CDxfRead %7.1f ms (%7.1f MB/s), %7lu lines, %7lu arcs, "
+               "AreaDxfRead %7.1f ms, %7lu curves\n",
+               file_mb, filter.name, read_ms, file_mb / read_ms * 1000.0, (unsigned long)reader.num_lines,
+               (unsigned long)reader.num_arcs, area_ms, (unsigned long)area.m_curves.size());
+    }
+    remove(path);
+}
+
+// a plate, a rounded slot with six holes in it, placed num_inserts times at random, turned and scaled.
+// as INSERTs of one BLOCK, or flattened, with each copy's LINEs, ARCs and CIRCLEs written out where they end up.
+// squashed INSERTs are scaled half as much in y as in x
+static void writeInsertDxf(const char* path, int num_inserts, bool flattened, bool squashed) {
+    FILE* f = fopen(path, "w");
+    if (!f) return;
+    auto entities = [&](const Point& at, double scale, double degrees) {
+        double a = degrees * M_PI / 180.0;
+        auto place = [&](double x, double y) {
+            return at + Point(x * cos(a) - y * sin(a), x * sin(a) + y * cos(a)) * scale;
+        };
+        for (double y : {-10.0, 10.0}) {
+            Point s = place(-30.0, y), e = place(30.0, y);
+            fprintf(f, "  0\nLINE\n  8\n0\n 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 11\n%.10g\n 21\n%.10g\n 31\n0.0\n", s.x, s.y,
+                    e.x, e.y);
+        }
+        for (double x : {-30.0, 30.0}) {
+            Point c = place(x, 0.0);
+            double a0 = ((x > 0) ? -90.0 : 90.0) + degrees;
+            fprintf(f, "  0\nARC\n  8\n0\n 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 40\n%.10g\n 50\n%.10g\n 51\n%.10g\n", c.x, c.y,
+                    10.0 * scale, a0, a0 + 180.0);
+        }
+        for (int i = 0; i < 6; i++) {
+            Point c = place(-25.0 + 10.0 * i, 0.0);
+            fprintf(f, "  0\nCIRCLE\n  8\n0\n 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 40\n%.10g\n", c.x, c.y, 2.0 * scale);
+        }
+    };
+
+    fprintf(f, "  0\nSECTION\n  2\nHEADER\n  9\n$INSUNITS\n 70\n4\n  0\nENDSEC\n");
+    if (!flattened) {
+        fprintf(f, "  0\nSECTION\n  2\nBLOCKS\n  0\nBLOCK\n  8\n0\n  2\nPLATE\n 70\n0\n 10\n0.0\n 20\n0.0\n 30\n0.0\n  3\nPLATE\n");
+        entities(Point(0, 0), 1.0, 0.0);
+        fprintf(f, "  0\nENDBLK\n  8\n0\n  0\nENDSEC\n");
+    }
+    fprintf(f, "  0\nSECTION\n  2\nENTITIES\n");
+    Random r;
+    for (int i = 0; i < num_inserts; i++) {
+        Point at(r.next(0.0, 10000.0), r.next(0.0, 10000.0));
+        double scale = r.next(0.5, 2.0);
+        double degrees = r.next(0.0, 360.0);
+        if (flattened) {
+            entities(at, scale, degrees);
+        } else {
+            fprintf(f, "  0\nINSERT\n  8\n0\n  2\nPLATE\n 10\n%.10g\n 20\n%.10g\n 30\n0.0\n 41\n%.10g\n 42\n%.10g\n 43\n1.0\n 50\n%.10g\n",
+                    at.x, at.y, scale, squashed ? scale * 0.5 : scale, degrees);
+        }
+    }
+    fprintf(f, "  0\nENDSEC\n  0\nEOF\n");
+    fclose(f);
+}
+
+static double absArea(const CArea& a) {
+    double area = 0.0;
+    for (const auto& c : a.m_curves) area += fabs(c.GetArea());
+    return area;
+}
+
+// AreaDxfRead expanding 10k INSERTs of a block, against not expanding them, and against reading the same parts flattened
+static void benchDxfInsert() {
+    const char* path = "area-bench.dxf";
+    const int n = 10000;
+    struct Case {
+        const char* name;
+        bool flattened, squashed, expand;
+    } cases[] = {{"inserts, not expanded", false, false, false},
+                 {"inserts", false, false, true},
+                 {"flattened", true, false, true},
+                 {"squashed inserts", false, true, true}};
+    for (const auto& c : cases) {
+        writeInsertDxf(path, n, c.flattened, c.squashed);
+        double file_mb = fileSize(path) / 1.0e6;
+        CArea area(ACCURACY);
+        Timer t;
+        {
+            AreaDxfRead reader(&area, path);
+            reader.m_expand_inserts = c.expand;
+            reader.DoRead();
+        }
+        double read_ms = t.ms();
+        printf("dxf-insert: %5d %-21s %6.2f MB: AreaDxfRead %7.1f ms, %5.2f us an insert, %6lu curves, %7lu vertices, area %.1f\n", n,
+               c.name, file_mb, read_ms, read_ms * 1000.0 / n, (unsigned long)area.m_curves.size(),
+               (unsigned long)numVertices(area), absArea(area));
+    }
+    remove(path);
+}
+
+// ---------------------------------------------------------------
+
+struct Bench {
+    const char* name;
+    std::function<void()> run;
+};
+
+int main(int ac, char** av) {
+    std::vector<Bench> benches = {
+        {"pocket", benchPocket},
+        {"inside", benchInside},
+        {"prepared", benchPrepared},
+        {"intersections", benchIntersections},
+        {"span-intersect", benchSpanIntersect},
+        {"curves", benchCurves},
+        {"bulge", benchBulge},
+        {"fit-arcs", benchFitArcs},
+        {"perim", benchPerim},
+        {"offset", benchOffset},
+        {"simplify", benchSimplify},
+        {"polyline", benchPolyline},
+        {"fit-threads", benchFitThreads},
+        {"kurve", benchKurve},
+        {"kurve-errors", benchKurveErrors},
+        {"dxf", benchDxf},
+        {"dxf-threads", benchDxfThreads},
+        {"dxf-join", benchDxfJoin},
+        {"dxf-binary", benchDxfBinary},
+        {"dxf-write", benchDxfWrite},
+        {"dxf-spline", benchDxfSpline},
+        {"dxf-filter", benchDxfFilter},
+        {"dxf-insert", benchDxfInsert},
+    };
+
+    for (const auto& b : benches) {
+        bool wanted = (ac < 2);
+        for (int i = 1; i < ac; i++) {
+            if (strcmp(av[i], b.name) == 0) wanted = true;
+        }
+        if (wanted) b.run();
+    }
+    return 0;
+}
@@ -0,0 +1,273 @@
+// dxf_test.cpp
+// Pass/fail checks for reading and writing DXF files; exits non-zero if any fail.
+// The DXF files are made here, in the working directory.
+
+#include "../src/Area.h"
+#include "../src/AreaDxf.h"
+#include "../src/Curve.h"
+#include "../src/dxf.h"
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+static const double ACCURACY = 0.01;
+static int num_failed = 0;
+
+static void
+check(bool ok, const char *what) {
+  printf("%s: %s\n", ok ? "pass" : "FAIL", what);
+  if (!ok) num_failed++;
+}
+
+static bool
+isNear(double a, double b, double tolerance = 1.0e-6) {
+  return fabs(a - b) < tolerance;
+}
+
+// group code and value lines of a text DXF
+static std::string
+group(int code, const std::string &value) {
+  return std::to_string(code) + "\n" + value + "\n";
+}
+
+static std::string
+group(int code, double value) {
+  char s[32];
+  snprintf(s, sizeof(s), "%.6f", value);
+  return group(code, std::string(s));
+}
+
+static std::string
+line(double x0, double y0, double x1, double y1, const char *layer = "0") {
+  return group(0, "LINE") + group(8, layer) + group(10, x0) + group(20, y0) + group(30, 0.0)
+    + group(11, x1) + group(21, y1) + group(31, 0.0);
+}
+
+static std::string
+arc(double cx, double cy, double radius, double start_angle, double end_angle, const char *layer = "0") {
+  return group(0, "ARC") + group(8, layer) + group(10, cx) + group(20, cy) + group(30, 0.0)
+    + group(40, radius) + group(50, start_angle) + group(51, end_angle);
+}
+
+static std::string
+square(double x, double y, double side, const char *layer = "0") {
+  return line(x, y, x + side, y, layer) + line(x + side, y, x + side, y + side, layer)
+    + line(x + side, y + side, x, y + side, layer) + line(x, y + side, x, y, layer);
+}
+
+static std::string
+insert(const char *name, double x, double y, double scale_x, double scale_y, double rotation) {
+  return group(0, "INSERT") + group(8, "0") + group(2, name) + group(10, x) + group(20, y) + group(30, 0.0)
+    + group(41, scale_x) + group(42, scale_y) + group(50, rotation);
+}
+
+static std::string
+section(const char *name, const std::string &body) {
+  return group(0, "SECTION") + group(2, name) + body + group(0, "ENDSEC");
+}
+
+static bool
+writeFile(const char *filepath, const std::string &data) {
+  FILE *fp = fopen(filepath, "wb");
+  if (fp == NULL) return false;
+  bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+  return (fclose(fp) == 0) && ok;
+}
+
+static void
+readArea(CArea &area, const char *filepath, const std::vector<std::string> &layers = {}) {
+  AreaDxfRead reader(&area, filepath);
+  reader.SetLayerFilter(layers);
+  reader.DoRead();
+}
+
+// a slot, 2 wide, with a half circle on top; the arc is drawn against the way the lines go round, and everything is out of order
+static void
+testChaining() {
+  std::string entities = arc(1, 2, 1, 0, 180) + line(2, 0, 0, 0) + line(2, 2, 2, 0) + line(0, 0, 0, 2);
+  writeFile("dxf_test_chain.dxf", section("ENTITIES", entities) + group(0, "EOF"));
+
+  CArea area(ACCURACY);
+  AreaDxfRead reader(&area, "dxf_test_chain.dxf");
+  reader.DoRead();
+  check(area.m_curves.size() == 1, "chaining: lines and a reversed arc make one curve");
+  check(reader.NumOpenCurves() == 0, "chaining: no open curves");
+  if (area.m_curves.size() != 1) return;
+  const CCurve &curve = area.m_curves.front();
+  check(curve.IsClosed(), "chaining: the curve is closed");
+  check(curve.HasArcs(), "chaining: the arc is kept as an arc");
+  check(isNear(fabs(curve.GetArea()), 4 + M_PI / 2), "chaining: area of the slot");
+  check(isNear(curve.Perim(), 6 + M_PI), "chaining: perimeter of the slot");
+}
+
+// an area written as a binary DXF reads back the same as when it is written as text
+static void
+testBinaryRoundTrip() {
+  CArea area(ACCURACY);
+  CCurve rect;
+  rect.append(Point(0, 0));
+  rect.append(Point(10, 0));
+  rect.append(Point(10, 5));
+  rect.append(Point(0, 5));
+  rect.append(Point(0, 0));
+  area.append(rect);
+  CCurve circle;
+  circle.append(Point(25, 0));
+  circle.append(CVertex(CVertex::vt_ccw_arc, Point(15, 0), Point(20, 0)));
+  circle.append(CVertex(CVertex::vt_ccw_arc, Point(25, 0), Point(20, 0)));
+  area.append(circle);
+
+  for (int polylines = 0; polylines < 2; polylines++) {
+    {
+      AreaDxfWrite writer("dxf_test_binary.dxf", true);
+      writer.m_polylines = (polylines != 0);
+      writer.WriteArea(area);
+    }
+    {
+      AreaDxfWrite writer("dxf_test_text.dxf");
+      writer.m_polylines = (polylines != 0);
+      writer.WriteArea(area);
+    }
+
+    CArea binary_area(ACCURACY), text_area(ACCURACY);
+    AreaDxfRead binary_reader(&binary_area, "dxf_test_binary.dxf");
+    binary_reader.DoRead();
+    readArea(text_area, "dxf_test_text.dxf");
+
+    std::string how = polylines ? " (LWPOLYLINEs)" : " (LINEs and ARCs)";
+    check(binary_reader.IsBinary() && !binary_reader.Failed(), ("binary: read as a binary DXF" + how).c_str());
+    check(binary_area.m_curves.size() == 2, ("binary: both curves read back" + how).c_str());
+    check(binary_area.m_curves.size() == text_area.m_curves.size(), ("binary: same curves as the text DXF" + how).c_str());
+    if (binary_area.m_curves.size() != 2 || text_area.m_curves.size() != 2) continue;
+
+    bool same = true;
+    auto it = text_area.m_curves.begin();
+    for (const CCurve &curve : binary_area.m_curves) {
+      const CCurve &text_curve = *it++;
+      if (curve.m_vertices.size() != text_curve.m_vertices.size()) {
+        same = false;
+        continue;
+      }
+      auto vt = text_curve.m_vertices.begin();
+      for (const CVertex &v : curve.m_vertices) {
+        const CVertex &tv = *vt++;
+        if (v.m_type != tv.m_type || v.m_p != tv.m_p || (v.m_type != 0 && v.m_c != tv.m_c)) same = false;
+      }
+    }
+    check(same, ("binary: vertices match the text DXF's" + how).c_str());
+    check(isNear(fabs(binary_area.m_curves.front().GetArea()), 50) && isNear(fabs(binary_area.m_curves.back().GetArea()), M_PI * 25),
+          ("binary: areas match what was written" + how).c_str());
+  }
+}
+
+// only the entities on the chosen layers are read
+static void
+testLayerFilter() {
+  std::string entities = square(0, 0, 1, "A") + square(10, 0, 2, "B") + square(20, 0, 3, "C");
+  writeFile("dxf_test_layers.dxf", section("ENTITIES", entities) + group(0, "EOF"));
+
+  CArea all(ACCURACY), b(ACCURACY), ac(ACCURACY);
+  readArea(all, "dxf_test_layers.dxf");
+  readArea(b, "dxf_test_layers.dxf", {"B"});
+  readArea(ac, "dxf_test_layers.dxf", {"A", "C"});
+  check(all.m_curves.size() == 3, "layers: no filter reads every layer");
+  check(b.m_curves.size() == 1 && isNear(fabs(b.m_curves.front().GetArea()), 4), "layers: only layer B");
+  check(ac.m_curves.size() == 2 && isNear(fabs(ac.m_curves.front().GetArea()), 1) && isNear(fabs(ac.m_curves.back().GetArea()), 9),
+        "layers: layers A and C, not B");
+}
+
+static bool
+boxIs(const CCurve &curve, double min_x, double min_y, double max_x, double max_y) {
+  CBox2D box;
+  curve.GetBox(box);
+  return isNear(box.MinX(), min_x) && isNear(box.MinY(), min_y) && isNear(box.MaxX(), max_x) && isNear(box.MaxY(), max_y);
+}
+
+// INSERTs move, scale, mirror and rotate their block's curves about the block's base point
+static void
+testInserts() {
+  std::string block = group(0, "BLOCK") + group(8, "0") + group(2, "SQ") + group(70, "0")
+    + group(10, 1.0) + group(20, 1.0) + group(30, 0.0) + group(3, "SQ") + square(1, 1, 1) + group(0, "ENDBLK") + group(8, "0");
+  std::string entities = insert("SQ", 10, 0, 2, 2, 90) + insert("SQ", 100, 0, -1, 1, 0) + insert("LATER", 0, 0, 1, 1, 0);
+  std::string later = group(0, "BLOCK") + group(8, "0") + group(2, "LATER") + group(70, "0")
+    + group(10, 0.0) + group(20, 0.0) + group(30, 0.0) + group(3, "LATER") + square(50, 50, 3) + group(0, "ENDBLK") + group(8, "0");
+  writeFile("dxf_test_inserts.dxf", section("BLOCKS", block) + section("ENTITIES", entities) + section("BLOCKS", later) + group(0, "EOF"));
+
+  CArea area(ACCURACY);
+  readArea(area, "dxf_test_inserts.dxf");
+  check(area.m_curves.size() == 3, "inserts: one curve for each INSERT, none for the blocks themselves");
+  if (area.m_curves.size() != 3) return;
+  auto it = area.m_curves.begin();
+  const CCurve &rotated = *it++;
+  const CCurve &mirrored = *it++;
+  const CCurve &later_block = *it++;
+  check(boxIs(rotated, 8, 0, 10, 2) && isNear(fabs(rotated.GetArea()), 4), "inserts: scaled by 2 and rotated 90 degrees about the base point");
+  check(boxIs(mirrored, 99, 0, 100, 1) && isNear(fabs(mirrored.GetArea()), 1), "inserts: mirrored in x");
+  check(boxIs(later_block, 50, 50, 53, 53), "inserts: a block defined after its INSERT");
+}
+
+// what a reader was given, in order, to compare one read with another
+class CDxfRecord : public CDxfRead {
+public:
+  std::vector<std::string> m_items;
+
+  CDxfRecord(const char *filepath) : CDxfRead(filepath) {}
+
+  void add(const char *type, const double *a, const double *b) {
+    char s[160];
+    snprintf(s, sizeof(s), "%s %s %.6f %.6f %.6f %.6f", type, LayerName().c_str(), a[0], a[1], b[0], b[1]);
+    m_items.push_back(s);
+  }
+
+  void OnReadLine(const double *s, const double *e) override { add("line", s, e); }
+  void OnReadArc(const double *s, const double *e, const double *c, bool dir) override { add(dir ? "ccw" : "cw", s, e); add("centre", c, c); }
+  void OnReadCircle(const double *s, const double *c, bool dir) override { add("circle", s, c); }
+};
+
+// an ENTITIES section big enough to be read on several threads gives the same items, in the same order, as reading it on one
+static void
+testThreads() {
+  std::string entities;
+  const char *layers[] = {"0", "walls", "doors", "windows"};
+  for (int i = 0; entities.size() < 6000000; i++) {
+    const char *layer = layers[(i / 1000) % 4];
+    double x = (i % 1000) * 3.0, y = (i / 1000) * 3.0;
+    if (i % 7 == 0) entities += arc(x, y, 1, 10, 200, layer);
+    else if (i % 11 == 0) entities += group(0, "CIRCLE") + group(8, layer) + group(10, x) + group(20, y) + group(30, 0.0) + group(40, 1.0);
+    else if (i % 13 == 0) entities += group(0, "LINE") + group(10, x) + group(20, y) + group(11, x + 1) + group(21, y); // no layer given
+    else entities += line(x, y, x + 1, y + 2, layer);
+  }
+  writeFile("dxf_test_threads.dxf", section("ENTITIES", entities) + group(0, "EOF"));
+
+  CDxfRecord serial("dxf_test_threads.dxf");
+  serial.DoRead();
+  CDxfRecord threaded("dxf_test_threads.dxf");
+  threaded.SetReadThreads(4);
+  threaded.DoRead();
+  check(!serial.Failed() && !threaded.Failed(), "threads: both reads succeed");
+  check(serial.m_items.size() > 50000, "threads: every entity read");
+  check(threaded.m_items == serial.m_items, "threads: 4 threads read the same as 1");
+
+  CDxfRecord serial_doors("dxf_test_threads.dxf");
+  serial_doors.SetLayerFilter({"doors"});
+  serial_doors.DoRead();
+  CDxfRecord threaded_doors("dxf_test_threads.dxf");
+  threaded_doors.SetLayerFilter({"doors"});
+  threaded_doors.SetReadThreads(4);
+  threaded_doors.DoRead();
+  check(!serial_doors.m_items.empty() && threaded_doors.m_items == serial_doors.m_items, "threads: 4 threads read the same as 1, with a layer filter");
+}
+
+int
+main(int ac, char **av) {
+  testChaining();
+  testBinaryRoundTrip();
+  testLayerFilter();
+  testInserts();
+  testThreads();
+
+  if (num_failed) printf("%d checks failed\n", num_failed);
+  else printf("all passed\n");
+  return num_failed ? 1 : 0;
+}